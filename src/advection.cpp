@@ -11,6 +11,8 @@ class Advection : public T_ConservationLaw<Advection<D>, D, 1, 0>
   typedef T_ConservationLaw<Advection<D>, D, 1, 0> BASE;
   
 public:
+  static constexpr bool linear = true;
+
   Advection (const shared_ptr<GridFunction> & agfu,
 	     const shared_ptr<TentPitchedSlab> & atps)
     : BASE (agfu, atps, "advection")
@@ -24,6 +24,8 @@ public:
   // using BASE::u_reflect;
   // using BASE::CalcEntropy;
 
+  bool UsesMappedPoints() const { return false; }
+
 
   // solve for û: Û = ĝ(x̂, t̂, û) - ∇̂ φ(x̂, t̂) ⋅ f̂(x̂, t̂, û)
   //
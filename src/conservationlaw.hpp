@@ -7,6 +7,7 @@
 #include "tents.hpp"
 #include "tentsolver.hpp"
 #include "vis3d.hpp"
+#include "paralleldepend.hpp"
 #include <atomic>
 
 class ConservationLaw
@@ -29,6 +30,22 @@ public:
 
   shared_ptr<TentSolver> tentsolver;
 
+  // element and facet data shared by the tents (built on first Propagate)
+  shared_ptr<MeshGeometryData> geomdata = nullptr;
+  // SARK stages by the fused CalcStageTent, otherwise by the separate
+  // Cyl2Tent, ApplyM1 and CalcFluxTent
+  bool fused_stages = true;
+
+  // optional cache of the finite element data of all tents
+  shared_ptr<TentDataFECache> fedata_cache = nullptr;
+
+  // algorithm running the tents in parallel
+  ngstents::TentScheduler scheduler = ngstents::EDynamicScheduler;
+  // maximal number of elements of fused tent clusters (0: no fusion)
+  double agglomeration = 0;
+  // counters of the tent scheduler in the last propagation
+  ngstents::SchedulerStats scheduler_stats;
+
   shared_ptr<GridFunction> gftau = nullptr;  // advancing front (used for time-dependent bc)
   shared_ptr<CoefficientFunction> cftau = nullptr;  // CF representing gftau
 
@@ -67,9 +84,45 @@ public:
 
   virtual void SetTentSolver(string method, int stages, int substeps) = 0;
 
+  // Enable (or disable) caching the TentDataFE of all tents across
+  // Propagate calls, using at most maxmemory bytes. Tents which do not
+  // fit into the budget are set up again on every Propagate.
+  void SetTentDataCache(bool enable, size_t maxmemory)
+  {
+    if (enable)
+      fedata_cache = make_shared<TentDataFECache>(maxmemory);
+    else
+      fedata_cache = nullptr;
+  }
+
+  // Evaluate the SARK stages by one fused kernel per element (default)
+  // or by the separate kernels, e.g. to compare the two.
+  void SetFusedStages(bool enable) { fused_stages = enable; }
+
+  // Replace the tent solver of a linear equation by precomputed matrices
+  // mapping the bottom (and inflow) dofs of every tent to its top dofs.
+  virtual void SetPrecomputedPropagator(bool enable) = 0;
+
+  // Priority bands of the tents of nslabs consecutive slabs used by the
+  // "priority" scheduler, band 0 holds the critical path.
+  virtual Array<int> PriorityBands(int nslabs) = 0;
+
   // virtual void Propagate(LocalHeap & lh) = 0;
 
-  virtual void Propagate(LocalHeap & lh, shared_ptr<GridFunction> hdgf) = 0;
+  // Propagate through nslabs consecutive copies of the tent slab. The
+  // tents of different slabs are scheduled together, so there is no
+  // barrier between the slabs.
+  virtual void Propagate(LocalHeap & lh, shared_ptr<GridFunction> hdgf,
+                         int nslabs) = 0;
+
+  // Propagate several solution vectors (with their initial data for the
+  // boundary conditions, or uinit if uinits is empty) through the slab.
+  // With precomputed propagators one matrix-matrix product per tent,
+  // otherwise the tent data is shared and the members are propagated one
+  // after the other.
+  virtual void PropagateEnsemble(LocalHeap & lh,
+                                 FlatArray<shared_ptr<BaseVector>> us,
+                                 FlatArray<shared_ptr<BaseVector>> uinits) = 0;
 
 };
 
@@ -115,11 +168,47 @@ protected:
   /// collection of tents in timeslab
   Table<int> & tent_dependency = tps->tent_dependency;
 
+  bool use_propagator = false;    ///< apply precomputed tent propagators
+  int propagator_version = -1;    ///< slab version of the propagators
+  Table<int> propagator_dofs;     ///< dofs of every tent
+  Array<Matrix<>> propagator;     ///< maps bottom to top dofs of every tent
+  Array<Matrix<>> propagator_bnd; ///< maps initial (inflow) data to top dofs
+
+  /// copies of u and uinit numbered by geomdata->dofmap, propagated
+  /// instead of u if the tents have been reordered
+  shared_ptr<BaseVector> u_tent, uinit_tent;
+  /// buffer for renumbering the entropy residual (gfres), which the
+  /// tents write by geomdata->dofmap as well
+  shared_ptr<BaseVector> res_tent;
+
+  Table<int> multislab_dependency; ///< DAG of several consecutive slabs
+  int multislab_nslabs = 0;        ///< number of slabs in this DAG
+  int multislab_version = -1;      ///< slab version of this DAG
+
+  ngstents::StaticSchedule static_schedule; ///< thread lists of the tents
+  int static_schedule_nslabs = 0;  ///< number of slabs of this schedule
+  int static_schedule_version = -1; ///< slab version of this schedule
+
+  Array<int> priority_bands;       ///< critical path priority of the tents
+  int priority_nslabs = 0;         ///< number of slabs of these priorities
+  int priority_version = -1;       ///< slab version of these priorities
+
+  ngstents::CoarseDependency coarse_dependency; ///< DAG of tent clusters
+  int coarse_nslabs = 0;           ///< number of slabs of this DAG
+  int coarse_version = -1;         ///< slab version of this DAG
+  double coarse_threshold = 0;     ///< agglomeration of this DAG
+
   const EQUATION & Cast() const {return static_cast<const EQUATION&> (*this);}
 
 public:
   enum { NCOMP = COMP };
   enum { NECOMP = ECOMP };
+  /// linear equations with time-independent coefficients may
+  /// use precomputed tent propagators
+  static constexpr bool linear = false;
+  /// whether the flux functions evaluate coefficient functions in the
+  /// mapped points (otherwise the affine elements share one mapped rule)
+  bool UsesMappedPoints() const { return true; }
 
   T_ConservationLaw (const shared_ptr<GridFunction> & gfu,
 		     const shared_ptr<TentPitchedSlab> & tps,
@@ -198,6 +287,8 @@ public:
         if(region.Test(ma->GetElIndex(sel)))
           bcnr[fnums[0]] = bc;
       }
+    // the propagators contain the boundary conditions
+    propagator_version = -1;
   }
 
   // Set old style boundary condition numbers from the mesh boundary elements indices.
@@ -221,6 +312,9 @@ public:
     else
       cout << "Resetting boundary values (discarding prior set values)"
 	   << endl;
+    // precomputed propagators can not take the boundary values, the next
+    // Propagate rebuilds them and reports this
+    propagator_version = -1;
   }
 
 
@@ -277,56 +371,37 @@ public:
     throw Exception("SetNumEntropyFlux just available for SymbolicConsLaw");
   }
 
-  template <int W>
+  // mat = M^-1 mat on the loci-th element, by the precomputed inverse
+  // diagonal or, for curved elements, the cached approximate inverse mass
+  // matrix (see MeshGeometryData::curvedinv)
+  template <int ORDER = -1, int W>
   void SolveM (const Tent & tent, int loci, FlatMatrixFixWidth<W> mat,
                LocalHeap & lh) const
   {
-    auto fedata = tent.fedata;
-    if (!fedata)
-        throw Exception ("Expected tent.fedata to be set!");
-
-    HeapReset hr(lh);
-    auto & fel = static_cast<const BaseScalarFiniteElement&> (*fedata->fei[loci]);
-
-    bool curved = ma->GetElement(ElementId(VOL,tent.els[loci])).is_curved;
-    if (curved)
+    const int elnr = tent.els[loci];
+    auto minv = geomdata->curvedinv[elnr];
+    if (minv.Height())
       {
-	FlatVector<> diagmass(mat.Height(),lh);
-	fel.GetDiagMassMatrix(diagmass);
-
-	SIMD_IntegrationRule & ir = *fedata->iri[loci];
-	SIMD_BaseMappedIntegrationRule & mir = *fedata->miri[loci];
-	FlatMatrix<SIMD<double>> pntvals(W, ir.Size(), lh);
-
-	for (int i : Range(mat.Height()))
-	  mat.Row(i) /= diagmass(i);
-        fel.Evaluate(ir, mat, pntvals);
-	for (int comp : Range(W))
-	  {
-            for(int i : Range(ir))
-              pntvals(comp,i) *= ir[i].Weight() / mir[i].GetMeasure();
-	  }
-        mat = 0.0;
-        fel.AddTrans(ir,pntvals, mat);
-	for (int i : Range(mat.Height()))
-	  mat.Row(i) /= diagmass(i);
+        HeapReset hr(lh);
+        FlatMatrix<> m(mat.Height(), W, mat.Data());
+        FlatMatrix<> temp(mat.Height(), W, lh);
+        temp = minv * m;
+        m = temp;
       }
-
     else
       {
-        FlatVector<> diagmass(mat.Height(),lh);
-
-        double measure = (*fedata->miri[loci])[0].GetMeasure()[0];
-        fel.GetDiagMassMatrix(diagmass);
-        for (size_t j = 0; j < diagmass.Size(); j++)
-          diagmass(j) = 1.0 / (diagmass(j) * measure);
-        for(size_t j = 0; j < mat.Height(); j++)
-          mat.Row (j) *= diagmass(j);
+        auto invmass = geomdata->invmass[elnr];
+        if constexpr (ORDER >= 0)
+          for (int j = 0; j < NDofOrder(ORDER); j++)
+            mat.Row(j) *= invmass(j);
+        else
+          for (size_t j = 0; j < mat.Height(); j++)
+            mat.Row(j) *= invmass(j);
       }
   }
 
 
-  template <int W>
+  template <int ORDER = -1, int W>
   void SolveM (const Tent & tent, int loci,
                FlatVector<SIMD<double>> delta,
                FlatMatrixFixWidth<W> mat, LocalHeap & lh) const
@@ -336,28 +411,210 @@ public:
         throw Exception ("Expected tent.fedata to be set!");
 
     HeapReset hr(lh);
-    auto & fel = static_cast<const BaseScalarFiniteElement&> (*fedata->fei[loci]);
+    const int elnr = tent.els[loci];
+    auto invdiag = geomdata->invdiag[elnr];
+    auto ipweight = geomdata->ipweight[elnr];
+    FlatMatrix<SIMD<double>> pntvals(W, ipweight.Size(), lh);
+
+    for (size_t j = 0; j < mat.Height(); j++)
+      mat.Row(j) *= invdiag(j);
+    EvaluateEl<ORDER>(*fedata, loci, mat, pntvals);
+    for (size_t k = 0; k < ipweight.Size(); k++)
+      pntvals.Col(k) *= ipweight(k) * delta(k); //scale with 1/delta
+    mat = 0.0;
+    AddTransEl<ORDER>(*fedata, loci, pntvals, mat);
+    for (size_t j = 0; j < mat.Height(); j++)
+      mat.Row(j) *= invdiag(j);
+  }
+
+  ////////////////////////////////////////////////////////////////
+  // element evaluations, by the tabulated basis if available. For
+  // ORDER >= 0 all elements are simplices of this order, and small
+  // products use the compile-time number of dofs (see FixedSize).
+  ////////////////////////////////////////////////////////////////
+
+  // number of dofs of the L2 simplex element of given order
+  static constexpr int NDofOrder (int p)
+  {
+    return (DIM == 1) ? p+1 :
+      (DIM == 2) ? (p+1)*(p+2)/2 : (p+1)*(p+2)*(p+3)/6;
+  }
 
-    FlatVector<> diagmass(mat.Height(),lh);
-    fel.GetDiagMassMatrix(diagmass);
+  // whether the products with W columns use the compile-time number of
+  // dofs. These keep NDOF x W sums in registers, larger blocks (e.g. 3D
+  // at order 3 or 4) would spill and are left to the matrix products.
+  template <int ORDER, int W>
+  static constexpr bool FixedSize ()
+  {
+    return ORDER >= 0 && NDofOrder(ORDER) * W <= 24;
+  }
+
+  // values = u in the IP's of the loci-th element of the tent
+  template <int ORDER = -1, int W>
+  void EvaluateEl (const TentDataFE & fedata, size_t loci,
+                   FlatMatrixFixWidth<W> coefs,
+                   FlatMatrix<SIMD<double>> values) const
+  {
+    auto tab = fedata.tabi[loci];
+    if constexpr (FixedSize<ORDER,W>())
+      if (tab)
+        {
+          tab->template EvaluateFix<W,NDofOrder(ORDER)>(coefs, values);
+          return;
+        }
+    if (tab)
+      tab->Evaluate(coefs, values);
+    else
+      static_cast<const BaseScalarFiniteElement&> (*fedata.fei[loci]).
+        Evaluate(*fedata.iri[loci], coefs, values);
+  }
+
+  // coefs += sum_k shape(x_k) values(x_k) in the IP's of the loci-th element
+  template <int ORDER = -1, int W>
+  void AddTransEl (const TentDataFE & fedata, size_t loci,
+                   FlatMatrix<SIMD<double>> values,
+                   FlatMatrixFixWidth<W> coefs) const
+  {
+    auto tab = fedata.tabi[loci];
+    if constexpr (FixedSize<ORDER,W>())
+      if (tab)
+        {
+          tab->template AddTransFix<W,NDofOrder(ORDER)>(values, coefs);
+          return;
+        }
+    if (tab)
+      tab->AddTrans(values, coefs);
+    else
+      static_cast<const BaseScalarFiniteElement&> (*fedata.fei[loci]).
+        AddTrans(*fedata.iri[loci], values, coefs);
+  }
 
-    SIMD_IntegrationRule & ir = *fedata->iri[loci];
-    SIMD_BaseMappedIntegrationRule & mir = *fedata->miri[loci];
-    FlatMatrix<SIMD<double>> pntvals(W, ir.Size(), lh);
+  // values = grad(u) in the IP's of the loci-th element, of height DIM*W.
+  // With a table the reference gradients are mapped by the inverse
+  // Jacobian, which is constant on affine elements.
+  template <int W>
+  void EvaluateGradEl (const TentDataFE & fedata, size_t loci,
+                       FlatMatrixFixWidth<W> coefs,
+                       FlatMatrix<SIMD<double>> values, LocalHeap & lh) const
+  {
+    auto tab = fedata.tabi[loci];
+    if (!tab)
+      {
+        auto & fel = static_cast<const BaseScalarFiniteElement&> (*fedata.fei[loci]);
+        for (size_t l : Range(W))
+          fel.EvaluateGrad(*fedata.miri[loci], coefs.Col(l),
+                           values.Rows(DIM*l, DIM*(l+1)));
+        return;
+      }
+    HeapReset hr(lh);
+    const size_t nip = fedata.iri[loci]->Size();
+    FlatMatrix<SIMD<double>> refvalues(W, DIM*nip, lh);
+    tab->EvaluateRefGrad(coefs, refvalues);
+    const bool affine = fedata.IsAffine(loci);
+    Mat<DIM,DIM,SIMD<double>> jinv;
+    if (affine)
+      jinv = fedata.jacinv[loci];
+    auto & dmir = static_cast<const SIMD_MappedIntegrationRule<DIM,DIM>&>
+      (*fedata.miri[loci]);
+    for (size_t k : Range(nip))
+      {
+        if (!affine)
+          jinv = dmir[k].GetJacobianInverse();
+        for (size_t l : Range(W))
+          for (size_t j : Range(DIM))
+            {
+              SIMD<double> hsum(0.0);
+              for (size_t r : Range(DIM))
+                hsum += jinv(r,j) * refvalues(l, r*nip+k);
+              values(DIM*l+j, k) = hsum;
+            }
+      }
+  }
 
-    for (int i : Range(mat.Height()))
-      mat.Row(i) /= diagmass(i);
-    fel.Evaluate(ir, mat, pntvals);
-    for (int comp : Range(W))
+  // coefs += sum_k grad(shape)(x_k) values(x_k), values of height DIM*W.
+  // With a table the values are mapped back by the inverse Jacobian
+  // (constant on affine elements) and multiplied by the reference
+  // gradients in one product.
+  template <int ORDER = -1, int W>
+  void AddGradTransEl (const TentDataFE & fedata, size_t loci,
+                       FlatMatrix<SIMD<double>> values,
+                       FlatMatrixFixWidth<W> coefs, LocalHeap & lh) const
+  {
+    auto tab = fedata.tabi[loci];
+    if (!tab)
       {
-        for(int i : Range(ir))
-          pntvals(comp,i) *= ir[i].Weight() *
-            delta(i) / mir[i].GetMeasure(); //scale with 1/delta
+        static_cast<const BaseScalarFiniteElement&> (*fedata.fei[loci]).
+          AddGradTrans(*fedata.miri[loci], values, coefs);
+        return;
       }
-    mat = 0.0;
-    fel.AddTrans(ir,pntvals, mat);
-    for (int i : Range(mat.Height()))
-      mat.Row(i) /= diagmass(i);
+    HeapReset hr(lh);
+    const size_t nip = fedata.iri[loci]->Size();
+    const bool affine = fedata.IsAffine(loci);
+    Mat<DIM,DIM,SIMD<double>> jinv;
+    if (affine)
+      jinv = fedata.jacinv[loci];
+    auto & dmir = static_cast<const SIMD_MappedIntegrationRule<DIM,DIM>&>
+      (*fedata.miri[loci]);
+    FlatMatrix<SIMD<double>> refvalues(W, DIM*nip, lh);
+    for (size_t k : Range(nip))
+      {
+        if (!affine)
+          jinv = dmir[k].GetJacobianInverse();
+        for (size_t l : Range(W))
+          for (size_t r : Range(DIM))
+            {
+              SIMD<double> hsum(0.0);
+              for (size_t j : Range(DIM))
+                hsum += jinv(r,j) * values(DIM*l+j, k);
+              refvalues(l, r*nip+k) = hsum;
+            }
+      }
+    if constexpr (FixedSize<ORDER,W>())
+      tab->template AddRefGradTransFix<W,NDofOrder(ORDER)>(refvalues, coefs);
+    else
+      tab->AddRefGradTrans(refvalues, coefs);
+  }
+
+  // values = u in the IP's of facet locf, seen from neighbour side
+  template <int ORDER = -1, int W>
+  void EvaluateFacet (const TentDataFE & fedata, size_t locf, int side,
+                      FlatMatrixFixWidth<W> coefs,
+                      FlatMatrix<SIMD<double>> values) const
+  {
+    auto tab = fedata.ftabi[locf][side];
+    if constexpr (FixedSize<ORDER,W>())
+      if (tab)
+        {
+          tab->template EvaluateFix<W,NDofOrder(ORDER)>(coefs, values);
+          return;
+        }
+    if (tab)
+      tab->Evaluate(coefs, values);
+    else
+      static_cast<const BaseScalarFiniteElement&>
+        (*fedata.fei[fedata.felpos[locf][side]]).
+        Evaluate(*fedata.firi[locf][side], coefs, values);
+  }
+
+  // coefs += sum_k shape(x_k) values(x_k) in the IP's of facet locf
+  template <int ORDER = -1, int W>
+  void AddTransFacet (const TentDataFE & fedata, size_t locf, int side,
+                      FlatMatrix<SIMD<double>> values,
+                      FlatMatrixFixWidth<W> coefs) const
+  {
+    auto tab = fedata.ftabi[locf][side];
+    if constexpr (FixedSize<ORDER,W>())
+      if (tab)
+        {
+          tab->template AddTransFix<W,NDofOrder(ORDER)>(values, coefs);
+          return;
+        }
+    if (tab)
+      tab->AddTrans(values, coefs);
+    else
+      static_cast<const BaseScalarFiniteElement&>
+        (*fedata.fei[fedata.felpos[locf][side]]).
+        AddTrans(*fedata.firi[locf][side], values, coefs);
   }
 
   template <typename SCAL>
@@ -402,10 +659,17 @@ public:
     throw Exception ("Transparent boundary just available for wave equation!");
   }
 
+  template <int ORDER = -1>
   void CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
 		    FlatMatrixFixWidth<COMP> u0, FlatMatrixFixWidth<COMP> flux,
 		    double tstar, int derive_cf_bnd, LocalHeap & lh);
 
+  // adds the numerical fluxes over the tent facets to flux
+  template <int ORDER = -1>
+  void AddFacetFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
+			FlatMatrixFixWidth<COMP> u0, FlatMatrixFixWidth<COMP> flux,
+			int derive_cf_bnd, LocalHeap & lh);
+
   ////////////////////////////////////////////////////////////////
   // entropy viscosity for nonlinear conservation laws
   ////////////////////////////////////////////////////////////////
@@ -465,35 +729,152 @@ public:
     throw Exception ("TransformBack for FlatMatrix<SIMD> not available");
   }
 
+  template <int ORDER = -1>
   void Cyl2Tent (const Tent & tent, double tstar,
 		 const FlatMatrixFixWidth<COMP> uhat, FlatMatrixFixWidth<COMP> u,
 		 LocalHeap & lh);
 
+  template <int ORDER = -1>
   void ApplyM1 (const Tent & tent, double tstar,
 		FlatMatrixFixWidth<COMP> u, FlatMatrixFixWidth<COMP> res,
 		LocalHeap & lh);
 
+  template <int ORDER = -1>
   void Tent2Cyl (const Tent & tent, double tstar,
 		 FlatMatrixFixWidth<COMP> u, FlatMatrixFixWidth<COMP> uhat,
                  bool solvemass, LocalHeap & lh);
+
+  // one SARK stage: u = Cyl2Tent(uhat) at tstar, m1u = ApplyM1(u) and
+  // flux = CalcFluxTent(u) at tstar_flux, sharing the flux evaluation
+  template <int ORDER = -1>
+  void CalcStageTent (const Tent & tent, double tstar, double tstar_flux,
+		      const FlatMatrixFixWidth<COMP> uhat,
+		      FlatMatrixFixWidth<COMP> u0, FlatMatrixFixWidth<COMP> u,
+		      FlatMatrixFixWidth<COMP> m1u, FlatMatrixFixWidth<COMP> flux,
+		      int derive_cf_bnd, LocalHeap & lh);
   
   ////////////////////////////////////////////////////////////////
   // time stepping methods 
   ////////////////////////////////////////////////////////////////
 
   void SetTentSolver(string method, int stages, int substeps)
+  {
+    // use the kernels specialised on the polynomial order if possible
+    switch (SpecialisedOrder())
+      {
+      case 0: MakeTentSolver<0>(method, stages, substeps); break;
+      case 1: MakeTentSolver<1>(method, stages, substeps); break;
+      case 2: MakeTentSolver<2>(method, stages, substeps); break;
+      case 3: MakeTentSolver<3>(method, stages, substeps); break;
+      case 4: MakeTentSolver<4>(method, stages, substeps); break;
+      case 5: MakeTentSolver<5>(method, stages, substeps); break;
+      default: MakeTentSolver<-1>(method, stages, substeps);
+      }
+    propagator_version = -1;
+  }
+
+  template <int ORDER>
+  void MakeTentSolver(string method, int stages, int substeps)
   {
     if(method == "SAT")
-      tentsolver = make_shared<SAT<T_ConservationLaw<EQUATION,DIM,COMP,ECOMP,SYMBOLIC>>>
+      tentsolver = make_shared<SAT<T_ConservationLaw<EQUATION,DIM,COMP,ECOMP,SYMBOLIC>,ORDER>>
 	(this->shared_from_this(), stages, substeps);
     else if(method == "SARK")
-      tentsolver = make_shared<SARK<T_ConservationLaw<EQUATION,DIM,COMP,ECOMP,SYMBOLIC>>>
+      tentsolver = make_shared<SARK<T_ConservationLaw<EQUATION,DIM,COMP,ECOMP,SYMBOLIC>,ORDER>>
 	(this->shared_from_this(), stages, substeps);
     else
       throw Exception("unknown TentSolver "+method);
   }
+
+  // the polynomial order if all elements are L2 simplices of this order
+  // and there are specialised kernels for it, -1 otherwise
+  int SpecialisedOrder() const
+  {
+    if (!dynamic_pointer_cast<L2HighOrderFESpace>(fes) || order < 0 || order > 5)
+      return -1;
+    const ELEMENT_TYPE et = (DIM == 1) ? ET_SEGM : (DIM == 2) ? ET_TRIG : ET_TET;
+    Array<DofId> dnums;
+    for (size_t i : Range(ma->GetNE(VOL)))
+      {
+        ElementId ei(VOL, i);
+        if (ma->GetElType(ei) != et)
+          return -1;
+        fes->GetDofNrs(ei, dnums);
+        if (int(dnums.Size()) != NDofOrder(order))
+          return -1;
+      }
+    return order;
+  }
+
+  /// drop the geometry data and everything built on it, it is rebuilt
+  /// with the current options in the next Propagate
+  void ResetGeometryData()
+  {
+    geomdata = nullptr;
+    if (fedata_cache)
+      fedata_cache->Clear();
+    propagator_version = -1;
+  }
+
+  void SetPrecomputedPropagator(bool enable)
+  {
+    if (enable && !EQUATION::linear)
+      throw Exception("Precomputed propagators just available for linear "
+                      "equations (wave, maxwell, advection)");
+    use_propagator = enable;
+    propagator_version = -1;
+    propagator.SetSize(0);
+    propagator_bnd.SetSize(0);
+  }
+
+  // assemble the propagator matrices of all tents by applying the
+  // tent solver to unit vectors
+  void BuildPropagators(LocalHeap & lh);
+
+  // number the dofs in the order the tents first visit them if the tents
+  // have been reordered (geomdata->dofmap), so that neighbouring tents
+  // work on neighbouring entries of u_tent
+  void UpdateTentDofs();
+  // copy vec to the tent-ordered vec_tent, or back
+  void CopyTentOrder(BaseVector & vec, BaseVector & vec_tent, bool back) const;
+  // renumber the entropy residual gfres to the tent order, or back
+  void CopyResidualTentOrder(bool back);
   
-  void Propagate(LocalHeap & lh, shared_ptr<GridFunction> hdgf);
+  // DAG of the tents of nslabs consecutive slabs, tent i of slab s
+  // has number s*ntents+i
+  const Table<int> & GetMultiSlabDependency(int nslabs);
+
+  // assignment of the tents of nslabs consecutive slabs to the threads
+  const ngstents::StaticSchedule & GetStaticSchedule(int nslabs);
+
+  // priority bands of the tents of nslabs consecutive slabs from their
+  // bottom levels in the DAG
+  FlatArray<int> GetPriorityBands(int nslabs);
+  Array<int> PriorityBands(int nslabs)
+  { return Array<int>(GetPriorityBands(nslabs)); }
+
+  // tents of nslabs consecutive slabs fused into clusters of at most
+  // agglomeration elements
+  const ngstents::CoarseDependency & GetCoarseDependency(int nslabs);
+
+  // call func(s*ntents+i) for all tents i of nslabs consecutive slabs s,
+  // respecting the tent dependencies, using the chosen scheduler
+  template <typename TFUNC>
+  void RunTents(int nslabs, TFUNC func);
+
+  void Propagate(LocalHeap & lh, shared_ptr<GridFunction> hdgf, int nslabs);
+
+  void PropagateEnsemble(LocalHeap & lh,
+                         FlatArray<shared_ptr<BaseVector>> us,
+                         FlatArray<shared_ptr<BaseVector>> uinits);
+
+  // PropagateEnsemble without propagator matrices: the tent data is set
+  // up once per tent for all members, the tent solver then runs member
+  // by member (its flux kernels are not batched over the members)
+  template <typename TINIT>
+  void PropagateEnsembleLocal(LocalHeap & lh,
+                              FlatArray<shared_ptr<BaseVector>> us,
+                              TINIT GetInit);
 
 };
 
@@ -78,6 +78,8 @@ public:
   using BASE::InverseMap;
   using BASE::CalcEntropy;
 
+  bool UsesMappedPoints() const { return false; }
+
   template <typename T>//SCAL=double>
   Mat<D+2,D,typename T::TELEM> Flux (const T & U) const
   {
@@ -9,6 +9,8 @@ class Maxwell : public T_ConservationLaw<Maxwell<D>, D, 2*D, 0>
   typedef T_ConservationLaw<Maxwell<D>, D, 2*D, 0> BASE;
   
 public:
+  static constexpr bool linear = true;
+
   Maxwell (const shared_ptr<GridFunction> & agfu,
 	   const shared_ptr<TentPitchedSlab> & atps)
     : BASE (agfu, atps, "maxwell")
@@ -18,6 +20,8 @@ public:
   using BASE::NumFlux;
   using BASE::InverseMap;
 
+  bool UsesMappedPoints() const { return false; }
+
   template<typename T>
   INLINE auto skew (T vec) const
   {
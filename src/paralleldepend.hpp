@@ -5,20 +5,93 @@
 using namespace ngsolve;
 #include "concurrentqueue.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <thread>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 
 namespace ngstents {
 
+/// algorithms for running the tents of a slab in parallel
+enum TentScheduler { EDynamicScheduler = 0, ELevelScheduler,
+                     EStaticScheduler, EPriorityScheduler };
+
 typedef moodycamel::ConcurrentQueue<int> TQueue;
 typedef moodycamel::ProducerToken TPToken;
 typedef moodycamel::ConsumerToken TCToken;
 
+using namespace ngstd;
 
-static TQueue queue;
 
-using namespace ngstd;
+////////////////////////////////////////////////////////////////////////////
+///
+/// Counters of one run of a tent scheduler
+///
+struct SchedulerStats
+{
+  size_t ntasks = 0;          ///< number of executed tasks
+  size_t idle_spins = 0;      ///< failed attempts to get a ready task
+  size_t parks = 0;           ///< number of times a worker went to sleep
+  size_t steals = 0;          ///< tasks not enqueued by the executing thread
+  size_t max_queue_depth = 0; ///< maximal number of ready tasks
+  size_t allocations = 0;     ///< heap allocations inside the tasks
+
+  void Add (const SchedulerStats & other)
+  {
+    ntasks += other.ntasks;
+    idle_spins += other.idle_spins;
+    parks += other.parks;
+    steals += other.steals;
+    max_queue_depth = max(max_queue_depth, other.max_queue_depth);
+    allocations += other.allocations;
+  }
+};
+
+
+// Idle strategy of the workers: spin with exponentially growing pauses
+// first, then park (sleep until a task is enqueued, with a timeout in
+// case the wakeup is missed).
+class IdleBackoff
+{
+  int step = 0;
+  static constexpr int max_spin_step = 10;
+
+public:
+  void Reset () { step = 0; }
 
+  // returns false if the caller should park
+  bool Spin ()
+  {
+    if (step >= max_spin_step) return false;
+    for (int k = 0; k < (1 << step); k++)
+      {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+      }
+    step++;
+    return true;
+  }
+};
+
+
+/// Run func(i) for all nodes i of the directed acyclic graph dag, where
+/// dag[i] lists the nodes that may only start after node i has finished.
+/// Every call uses its own ready queue, so independent graphs may be
+/// processed concurrently. If band is given, ready nodes of a lower band
+/// are started first (see PriorityBands), otherwise in FIFO order. If
+/// stats is given, the scheduler counters of this run are returned there.
 template <typename TFUNC>
-void RunParallelDependency (const Table<int> & dag, TFUNC func)
+void RunParallelDependency (const Table<int> & dag, TFUNC func,
+                            SchedulerStats * stats = nullptr,
+                            FlatArray<int> band = FlatArray<int>())
 {
   Array<atomic<int>> cnt_dep(dag.Size());
 
@@ -44,90 +117,541 @@ void RunParallelDependency (const Table<int> & dag, TFUNC func)
       if (dag[j].Size() == 0) num_final++;
     }
 
-
-  /*
-    while (ready.Size())
+  if (!task_manager)
     {
-    int size = ready.Size();
-    int nr = ready[size-1];
-    ready.SetSize(size-1);
-
-    func(nr);
-
-    for (int j : dag[nr])
-    {
-    cnt_dep[j]--;
-    if (cnt_dep[j] == 0)
-    ready.Append(j);
+      // no threads available, process the graph serially
+      SchedulerStats serial_stats;
+      serial_stats.max_queue_depth = ready.Size();
+      while (ready.Size())
+        {
+          // the last ready node of the highest priority band
+          int pos = ready.Size()-1;
+          if (band.Size())
+            for (int k = pos-1; k >= 0; k--)
+              if (band[ready[k]] < band[ready[pos]])
+                pos = k;
+          int nr = ready[pos];
+          ready.DeleteElement(pos);
+
+          func(nr);
+          serial_stats.ntasks++;
+
+          for (int j : dag[nr])
+            if (--cnt_dep[j] == 0)
+              ready.Append(j);
+          serial_stats.max_queue_depth =
+            max(serial_stats.max_queue_depth, ready.Size());
+        }
+      if (stats) *stats = serial_stats;
+      return;
     }
-    }
-  */
 
+  // one queue per priority band
+  int nbands = 1;
+  for (int b : band)
+    nbands = max(nbands, b+1);
+  auto GetBand = [band] (int nr) { return band.Size() ? band[nr] : 0; };
 
+  Array<TQueue> queues(nbands);
   atomic<int> cnt_final(0);
+  atomic<int> queue_depth(ready.Size());
   SharedLoop sl(Range(ready));
 
-  Array< Vec<3> > timings(task_manager -> GetNumThreads());
-  // double starttime = omp_get_wtime();
+  std::mutex park_mutex;
+  std::condition_variable park_cv;
+  atomic<int> nparked(0);
 
+  Array<SchedulerStats> thread_stats(task_manager -> GetNumThreads());
 
   task_manager -> CreateJob
     ([&] (const TaskInfo & ti)
      {
-       TPToken ptoken(queue);
-       TCToken ctoken(queue);
+       std::vector<TPToken> ptokens;
+       std::vector<TCToken> ctokens;
+       ptokens.reserve(nbands);
+       ctokens.reserve(nbands);
+       for (auto & queue : queues)
+         {
+           ptokens.emplace_back(queue);
+           ctokens.emplace_back(queue);
+         }
+       SchedulerStats & mystats = thread_stats[ti.thread_nr];
+       IdleBackoff backoff;
+
+       auto Enqueue = [&] (int nr)
+         {
+           int b = GetBand(nr);
+           queues[b].enqueue (ptokens[b], nr);
+         };
+       // highest priority band first, own tasks first within a band
+       auto Dequeue = [&] (int & nr)
+         {
+           for (int b = 0; b < nbands; b++)
+             {
+               if (queues[b].try_dequeue_from_producer(ptokens[b], nr))
+                 return true;
+               if (queues[b].try_dequeue(ctokens[b], nr))
+                 {
+                   mystats.steals++;
+                   return true;
+                 }
+             }
+           return false;
+         };
+       auto QueueEmpty = [&] ()
+         {
+           for (auto & queue : queues)
+             if (queue.size_approx()) return false;
+           return true;
+         };
 
        for (int i : sl)
-	 queue.enqueue (ptoken, ready[i]);
+	 Enqueue (ready[i]);
 
        while (1)
 	 {
 	   if (cnt_final >= num_final) break;
 
 	   int nr;
-	   if(!queue.try_dequeue_from_producer(ptoken, nr))
-	     if(!queue.try_dequeue(ctoken, nr))
+	   if (!Dequeue(nr))
+	     {
+	       mystats.idle_spins++;
+	       if (!backoff.Spin())
+		 {
+		   std::unique_lock<std::mutex> lock(park_mutex);
+		   nparked++;
+		   if (QueueEmpty() && cnt_final < num_final)
+		     {
+		       mystats.parks++;
+		       park_cv.wait_for(lock, std::chrono::microseconds(200));
+		     }
+		   nparked--;
+		   backoff.Reset();
+		 }
 	       continue;
+	     }
+	   backoff.Reset();
+	   queue_depth--;
 
-	   if (dag[nr].Size() == 0)
-	     cnt_final++;
+	   bool final = (dag[nr].Size() == 0);
 
 	   func(nr);
+	   mystats.ntasks++;
 
+	   int nnew = 0;
 	   for (int j : dag[nr])
 	     {
 	       if (--cnt_dep[j] == 0)
-		 queue.enqueue (ptoken, j);
+		 {
+		   Enqueue (j);
+		   nnew++;
+		 }
+	     }
+
+	   if (nnew)
+	     {
+	       size_t depth = (queue_depth += nnew);
+	       mystats.max_queue_depth = max(mystats.max_queue_depth, depth);
+	     }
+
+	   bool done = final && (++cnt_final >= num_final);
+	   if ((nnew || done) && nparked > 0)
+	     {
+	       std::lock_guard<std::mutex> guard(park_mutex);
+	       if (done || nnew > 1)
+		 park_cv.notify_all();
+	       else
+		 park_cv.notify_one();
 	     }
 	 }
      });
 
-  /*
-  // my own simple parall
-  MyQueue<int> queue(dag.Size());
+  if (stats)
+    {
+      *stats = SchedulerStats();
+      stats->max_queue_depth = ready.Size();
+      for (auto & ts : thread_stats)
+        stats->Add(ts);
+    }
+}
+
+
+/// Bottom level of every node of the DAG dag, i.e. the cost of the most
+/// expensive path from the node to a sink, including the node itself.
+inline Array<double> ComputeBottomLevels (const Table<int> & dag,
+                                          FlatArray<double> cost)
+{
+  const size_t n = dag.Size();
+  Array<int> cnt_dep(n);
+  cnt_dep = 0;
+  for (int i : Range(dag))
+    for (int j : dag[i])
+      cnt_dep[j]++;
+
+  // topological order
+  Array<int> order;
+  order.SetAllocSize(n);
+  for (int i : Range(n))
+    if (cnt_dep[i] == 0) order.Append(i);
+  for (size_t k = 0; k < order.Size(); k++)
+    for (int j : dag[order[k]])
+      if (--cnt_dep[j] == 0)
+        order.Append(j);
+
+  Array<double> blevel(n);
+  for (int k = n-1; k >= 0; k--)
+    {
+      int i = order[k];
+      double maxsucc = 0;
+      for (int j : dag[i])
+        maxsucc = max(maxsucc, blevel[j]);
+      blevel[i] = cost[i] + maxsucc;
+    }
+  return blevel;
+}
+
+
+/// Quantize the bottom levels into nbands priority bands for
+/// RunParallelDependency, band 0 holds the nodes on the critical path.
+inline Array<int> PriorityBands (FlatArray<double> blevel, int nbands = 8)
+{
+  double maxlevel = 0;
+  for (double bl : blevel)
+    maxlevel = max(maxlevel, bl);
+
+  Array<int> band(blevel.Size());
+  for (int i : Range(blevel))
+    band[i] = (maxlevel > 0)
+      ? min(nbands-1, int(nbands * (1 - blevel[i] / maxlevel)))
+      : 0;
+  return band;
+}
+
+
+/// Run func(i) for all i in the rows of layers, one layer after the
+/// other. The entries of a layer must be independent of each other and
+/// may only depend on entries of previous layers.
+template <typename TFUNC>
+void RunLevelSynchronous (const Table<int> & layers, TFUNC func,
+                          SchedulerStats * stats = nullptr)
+{
+  SchedulerStats level_stats;
+  for (auto layer : layers)
+    {
+      ParallelFor (Range(layer), [&] (int i) { func(layer[i]); });
+      level_stats.ntasks += layer.Size();
+      level_stats.max_queue_depth =
+        max(level_stats.max_queue_depth, layer.Size());
+    }
+  if (stats) *stats = level_stats;
+}
+
 
-  for (int i : ready)
-  queue.Push(i);
+////////////////////////////////////////////////////////////////////////////
+///
+/// Fixed assignment of the nodes of a DAG to threads: thread t executes
+/// the nodes tasks[t] in this order.
+///
+struct StaticSchedule
+{
+  int nthreads = 0;
+  Table<int> tasks;
+};
+
+
+/// List scheduling of the DAG dag (see RunParallelDependency) on nthreads
+/// threads, where node i is estimated to take time cost[i]. Nodes are
+/// taken in the order they become ready in the simulated execution. A
+/// node stays on the thread of its last finishing predecessor, unless
+/// another thread could start it earlier.
+inline StaticSchedule ComputeStaticSchedule (const Table<int> & dag,
+                                             FlatArray<double> cost,
+                                             int nthreads)
+{
+  const size_t n = dag.Size();
+  Array<int> cnt_dep(n);
+  cnt_dep = 0;
+  for (int i : Range(dag))
+    for (int j : dag[i])
+      cnt_dep[j]++;
+
+  Array<double> start(n), thread_free(nthreads);
+  Array<int> owner(n), thread_of(n), order;
+  order.SetAllocSize(n);
+  start = 0;
+  owner = -1;
+  thread_free = 0;
+
+  // ready nodes, earliest possible start first
+  typedef std::pair<double,int> TReady;
+  std::priority_queue<TReady, std::vector<TReady>, std::greater<TReady>> ready;
+  for (int i : Range(n))
+    if (cnt_dep[i] == 0)
+      ready.push (TReady(0, i));
+
+  while (!ready.empty())
+    {
+      auto [est, nr] = ready.top();
+      ready.pop();
+      order.Append(nr);
+
+      int best = 0;
+      for (int t : Range(nthreads))
+        if (thread_free[t] < thread_free[best])
+          best = t;
+      int p = owner[nr];
+      if (p < 0 || max(thread_free[p], est) > max(thread_free[best], est))
+        p = best;
+
+      double finish = max(thread_free[p], est) + cost[nr];
+      thread_free[p] = finish;
+      thread_of[nr] = p;
+
+      for (int j : dag[nr])
+        {
+          if (finish >= start[j])
+            {
+              start[j] = finish;
+              owner[j] = p;
+            }
+          if (--cnt_dep[j] == 0)
+            ready.push (TReady(start[j], j));
+        }
+    }
+
+  // the order of the simulation is a topological order, keep it per thread
+  StaticSchedule schedule;
+  schedule.nthreads = nthreads;
+  TableCreator<int> create_tasks(nthreads);
+  for ( ; !create_tasks.Done(); create_tasks++)
+    for (int i : order)
+      create_tasks.Add (thread_of[i], i);
+  schedule.tasks = create_tasks.MoveTable();
+  return schedule;
+}
+
+
+/// Run func(i) for all nodes i of the DAG dag following the precomputed
+/// schedule. Every thread processes its own list of nodes and waits for
+/// the predecessors of a node on a per-node counter, there is no shared
+/// queue. The schedule must be computed for the number of threads of the
+/// task manager. A thread waiting for a predecessor runs ready nodes from
+/// the heads of the other lists, so the run also completes if the tasks
+/// of the job are not executed concurrently (nested or sequential jobs).
+template <typename TFUNC>
+void RunStaticSchedule (const Table<int> & dag, const StaticSchedule & schedule,
+                        TFUNC func, SchedulerStats * stats = nullptr)
+{
+  if (!task_manager || schedule.nthreads != task_manager->GetNumThreads())
+    {
+      RunParallelDependency (dag, func, stats);
+      return;
+    }
+
+  Array<atomic<int>> cnt_dep(dag.Size());
+  for (auto & d : cnt_dep)
+    d.store (0, memory_order_relaxed);
+  ParallelFor (Range(dag),
+               [&] (int i)
+               {
+                 for (int j : dag[i])
+                   cnt_dep[j].fetch_add (1, memory_order_relaxed);
+               });
+
+  // position of the first unclaimed node in every list. The lists are
+  // in one topological order, so the earliest of the heads is always
+  // ready once all claimed nodes are done.
+  Array<atomic<size_t>> head(schedule.nthreads);
+  for (auto & h : head)
+    h.store (0, memory_order_relaxed);
+
+  Array<SchedulerStats> thread_stats(schedule.nthreads);
+
+  // claim the node at position k of list t and run it, returns false if
+  // another thread was faster
+  auto TryRun = [&] (int t, size_t k, SchedulerStats & mystats)
+    {
+      if (!head[t].compare_exchange_strong (k, k+1, memory_order_acq_rel))
+        return false;
+      int nr = schedule.tasks[t][k];
+      func(nr);
+      mystats.ntasks++;
+      for (int j : dag[nr])
+        cnt_dep[j].fetch_sub (1, memory_order_release);
+      return true;
+    };
+
+  // the ready node at the head of list t, or -1
+  auto ReadyHead = [&] (int t, size_t & k)
+    {
+      k = head[t].load (memory_order_acquire);
+      if (k >= schedule.tasks[t].Size())
+        return -1;
+      int nr = schedule.tasks[t][k];
+      return cnt_dep[nr].load (memory_order_acquire) == 0 ? nr : -1;
+    };
 
   task_manager -> CreateJob
-  ([&] (const TaskInfo & ti)
-  {
-  while (1)
-  {
-  int nr;
-  if (!queue.Pop(nr)) break;
+    ([&] (const TaskInfo & ti)
+     {
+       const int me = ti.task_nr;
+       SchedulerStats & mystats = thread_stats[me];
+       IdleBackoff backoff;
+       while (head[me].load (memory_order_acquire) < schedule.tasks[me].Size())
+         {
+           size_t k;
+           if (ReadyHead(me, k) >= 0)
+             {
+               TryRun(me, k, mystats);
+               backoff.Reset();
+               continue;
+             }
+
+           bool helped = false;
+           for (int t = 0; t < schedule.nthreads && !helped; t++)
+             if (t != me && ReadyHead(t, k) >= 0 && TryRun(t, k, mystats))
+               {
+                 mystats.steals++;
+                 helped = true;
+               }
+           if (helped)
+             {
+               backoff.Reset();
+               continue;
+             }
+
+           mystats.idle_spins++;
+           if (!backoff.Spin())
+             std::this_thread::yield();
+         }
+     }, schedule.nthreads);
+
+  if (stats)
+    {
+      *stats = SchedulerStats();
+      for (auto & ts : thread_stats)
+        stats->Add(ts);
+    }
+}
 
-  func(nr);
 
-  for (int j : dag[nr])
-  {
-  if (--cnt_dep[j] == 0)
-  queue.Push (j);
-  }
-  }
-  ptqend[ti.task_nr] = omp_get_wtime();
-  });
-  */
+////////////////////////////////////////////////////////////////////////////
+///
+/// Coarsened DAG: node c of dag stands for the nodes clusters[c] of the
+/// fine DAG, which have to be processed in the given order.
+///
+struct CoarseDependency
+{
+  Table<int> clusters;
+  Table<int> dag;
+};
+
+
+/// Fuse the nodes of the DAG dag into clusters of total cost at most
+/// threshold. Linear chains (a node with a single successor which has no
+/// other predecessor) are fused first, then the remaining single nodes
+/// of the same level (longest path from a source) are grouped. Edges
+/// between clusters always go from a lower to a higher level, so the
+/// coarse graph is acyclic.
+inline CoarseDependency CoarsenDependency (const Table<int> & dag,
+                                           FlatArray<double> cost,
+                                           double threshold)
+{
+  const size_t n = dag.Size();
+  Array<int> npred(n), cnt_dep(n);
+  npred = 0;
+  for (int i : Range(dag))
+    for (int j : dag[i])
+      npred[j]++;
+  cnt_dep = npred;
+
+  // topological order and levels
+  Array<int> order, level(n);
+  order.SetAllocSize(n);
+  level = 0;
+  for (int i : Range(n))
+    if (cnt_dep[i] == 0) order.Append(i);
+  for (size_t k = 0; k < order.Size(); k++)
+    for (int j : dag[order[k]])
+      {
+        level[j] = max(level[j], level[order[k]]+1);
+        if (--cnt_dep[j] == 0)
+          order.Append(j);
+      }
+
+  // fuse linear chains
+  Array<int> cluster(n);
+  cluster = -1;
+  Array<int> chainlen;
+  Array<double> chaincost;
+  for (int i : order)
+    {
+      if (cluster[i] != -1) continue;
+      int c = chainlen.Size();
+      cluster[i] = c;
+      int len = 1;
+      double sum = cost[i];
+      for (int nr = i; dag[nr].Size() == 1; len++)
+        {
+          int j = dag[nr][0];
+          if (npred[j] != 1 || sum + cost[j] > threshold) break;
+          cluster[j] = c;
+          sum += cost[j];
+          nr = j;
+        }
+      chainlen.Append(len);
+      chaincost.Append(sum);
+    }
+
+  // group single nodes of one level
+  auto Fused = [&] (int c) { return chainlen[c] > 1 || chaincost[c] >= threshold; };
+  int maxlevel = 0;
+  for (int l : level)
+    maxlevel = max(maxlevel, l);
+  Array<int> open_group(maxlevel+1);
+  Array<double> open_cost(maxlevel+1);
+  open_group = -1;
+  Array<int> coarse(chainlen.Size());
+  int ncoarse = 0;
+  for (int i : order)
+    {
+      int c = cluster[i];
+      if (Fused(c)) continue;
+      int l = level[i];
+      if (open_group[l] == -1 || open_cost[l] + chaincost[c] > threshold)
+        {
+          open_group[l] = c;
+          open_cost[l] = 0;
+        }
+      coarse[c] = open_group[l];
+      open_cost[l] += chaincost[c];
+    }
+  // number the clusters
+  Array<int> number(chainlen.Size());
+  number = -1;
+  for (int i : order)
+    {
+      int c = cluster[i];
+      int root = Fused(c) ? c : coarse[c];
+      if (number[root] == -1) number[root] = ncoarse++;
+      cluster[i] = number[root];
+    }
+
+  CoarseDependency result;
+  TableCreator<int> create_clusters(ncoarse);
+  for ( ; !create_clusters.Done(); create_clusters++)
+    for (int i : order)
+      create_clusters.Add (cluster[i], i);
+  result.clusters = create_clusters.MoveTable();
+
+  TableCreator<int> create_dag(ncoarse);
+  for ( ; !create_dag.Done(); create_dag++)
+    for (int i : Range(n))
+      for (int j : dag[i])
+        if (cluster[i] != cluster[j])
+          create_dag.Add (cluster[i], cluster[j]);
+  result.dag = create_dag.MoveTable();
+  return result;
 }
 
 }
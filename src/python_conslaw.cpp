@@ -262,6 +262,154 @@ void ExportConsLaw(py::module & m)
              before applying the tent solver method.
            ----------- )"
 	 )
+    .def("SetFusedStages",
+         [](shared_ptr<CL> self, bool enable)
+         {
+           self->SetFusedStages(enable);
+         },
+	 py::arg("enable")=true,
+	 R"(
+         Evaluate every SARK stage by one fused kernel per element, which
+         maps to the tent variables and computes the flux only once
+         (default), or by the separate kernels. The results coincide for
+         fluxes that do not depend on time.
+
+         Parameters:--
+           enable: use the fused stage kernel.
+           ----------- )"
+	 )
+    .def("SetPrecomputedPropagator",
+         [](shared_ptr<CL> self, bool enable)
+         {
+           self->SetPrecomputedPropagator(enable);
+         },
+	 py::arg("enable")=true,
+	 R"(
+         Assemble the update of every tent by the tent solver into a dense
+         matrix once per pitched slab and apply these matrices in Propagate.
+         Available for the linear equations (wave, maxwell, advection) with
+         time-independent coefficients and without boundary coefficient
+         functions. Memory grows with the square of the dofs per tent.
+
+         Parameters:--
+           enable: turn the precomputed propagators on or off.
+           ----------- )"
+	 )
+    .def("SetTentDataCache",
+         [](shared_ptr<CL> self, bool enable, size_t maxmemory)
+         {
+           self->SetTentDataCache(enable, maxmemory);
+         },
+	 py::arg("enable")=true, py::arg("maxmemory")=size_t(1000)*1000*1000,
+	 R"(
+         Keep the finite element data of every tent (transformations,
+         integration rules, gradients of the advancing fronts) in memory,
+         so that it is computed once per pitched slab instead of on every
+         Propagate call.
+
+         Parameters:--
+           enable: turn the cache on or off.
+           maxmemory: memory budget of the cache in bytes. Tents that do
+             not fit are set up again on every Propagate call.
+           ----------- )"
+	 )
+    .def("TentDataCacheInfo",
+         [](shared_ptr<CL> self)
+         {
+           py::dict info;
+           auto cache = self->fedata_cache;
+           info["enabled"] = bool(cache);
+           info["ntents"] = self->tps->GetNTents();
+           info["ncached"] = cache ? cache->GetNCached() : 0;
+           info["memory"] = cache ? cache->GetMemoryUsage() : 0;
+           info["maxmemory"] = cache ? cache->GetMaxMemory() : 0;
+           info["geometry_memory"] =
+             self->geomdata ? self->geomdata->GetMemoryUsage() : 0;
+           return info;
+         }, "number of cached tents and memory used by the tent data cache")
+    .def("SetScheduler",
+         [](shared_ptr<CL> self, string scheduler)
+         {
+           if (scheduler == "dynamic")
+             self->scheduler = ngstents::EDynamicScheduler;
+           else if (scheduler == "levels")
+             self->scheduler = ngstents::ELevelScheduler;
+           else if (scheduler == "static")
+             self->scheduler = ngstents::EStaticScheduler;
+           else if (scheduler == "priority")
+             self->scheduler = ngstents::EPriorityScheduler;
+           else
+             throw Exception("unknown tent scheduler " + scheduler +
+                             ", use \"dynamic\", \"levels\", \"static\""
+                             " or \"priority\"");
+         },
+	 py::arg("scheduler")="dynamic",
+	 R"(
+         Choose the algorithm running the tents of a slab in parallel.
+
+         Parameters:--
+           scheduler: "dynamic" starts every tent as soon as the tents it
+             depends on are done, "levels" processes the tents level by
+             level with a barrier after each level, "static" assigns the
+             tents to the threads once per slab and replays this
+             assignment in every Propagate call, "priority" works like
+             "dynamic" but starts tents on the critical path (longest
+             remaining chain of dependent tents) first.
+           ----------- )"
+	 )
+    .def("PriorityBands",
+         [](shared_ptr<CL> self, int nslabs)
+         {
+           py::list bands;
+           for (int b : self->PriorityBands(nslabs))
+             bands.append(b);
+           return bands;
+         },
+	 py::arg("nslabs")=1,
+	 R"(
+         Priority band of every tent used by the "priority" scheduler,
+         band 0 holds the tents on the critical path.
+
+         Parameters:--
+           nslabs: number of consecutive slabs scheduled together, tent i
+             of slab s has number s*ntents+i.
+           ----------- )"
+	 )
+    .def("SetTentAgglomeration",
+         [](shared_ptr<CL> self, double maxels)
+         {
+           if (maxels < 0)
+             throw Exception("SetTentAgglomeration needs a nonnegative size");
+           self->agglomeration = maxels;
+         },
+	 py::arg("maxels")=0,
+	 R"(
+         Fuse chains of dependent tents and small tents of the same level
+         into tasks of the "dynamic" scheduler, which are processed
+         serially by one thread. Reduces the scheduling overhead for many
+         cheap tents (fine meshes, low order).
+
+         Parameters:--
+           maxels: maximal number of elements of all tents of one task,
+             0 turns the fusion off.
+           ----------- )"
+	 )
+    .def("SchedulerStats",
+         [](shared_ptr<CL> self)
+         {
+           py::dict info;
+           auto & stats = self->scheduler_stats;
+           info["ntasks"] = stats.ntasks;
+           info["idle_spins"] = stats.idle_spins;
+           info["parks"] = stats.parks;
+           info["steals"] = stats.steals;
+           info["max_queue_depth"] = stats.max_queue_depth;
+           info["allocations"] = stats.allocations;
+           info["allocations_counted"] = ngstents::CountsAllocations();
+           return info;
+         }, "counters of the tent scheduler in the last Propagate call "
+            "(allocations are only counted if built with "
+            "NGSTENTS_COUNT_ALLOCATIONS, see allocations_counted)")
     .def("SetIdx3d",
          [](shared_ptr<CL> self, py::list lst)
          {
@@ -283,11 +431,49 @@ void ExportConsLaw(py::module & m)
          }, "Set index for visualization on a 3D mesh", py::arg("idx3d"))
     .def("Propagate",
          [](shared_ptr<CL> self,
-            shared_ptr<GridFunction> hdgf)
+            shared_ptr<GridFunction> hdgf, int nslabs)
+         {
+            self->Propagate(*(self->pylh), hdgf, nslabs);
+         },
+         py::arg("hdgf")=nullptr, py::arg("nslabs")=1,
+	 R"(
+         Propagate the solution through the tent slab.
+
+         Parameters:--
+           hdgf: GridFunction vector for visualization on 3D mesh.
+           nslabs: number of consecutive slabs to propagate through. The
+             tents of all slabs are scheduled together, so that no thread
+             waits at the end of a slab. Equivalent to nslabs calls with
+             nslabs=1.
+           ----------- )")
+    .def("PropagateEnsemble",
+         [](shared_ptr<CL> self, py::list sols, py::list inits)
          {
-            self->Propagate(*(self->pylh), hdgf);
-         }, "GridFunction vector for visualization on 3D mesh"
-         , py::arg("hdgf")=nullptr)
+           Array<shared_ptr<BaseVector>> us, uinits;
+           for (auto gf : sols)
+             us.Append(gf.cast<shared_ptr<GridFunction>>()->GetVectorPtr());
+           for (auto gf : inits)
+             uinits.Append(gf.cast<shared_ptr<GridFunction>>()->GetVectorPtr());
+           self->PropagateEnsemble(*(self->pylh), us, uinits);
+         },
+         py::arg("sols"), py::arg("inits")=py::list(),
+	 R"(
+         Propagate several solutions through the tent slab at once. With
+         precomputed propagators (SetPrecomputedPropagator) one
+         matrix-matrix product per tent updates all solutions. Otherwise,
+         e.g. for nonlinear equations, the data of each tent is set up
+         once and the solutions are propagated one after the other in it
+         (the flux evaluations are not batched over the solutions). The
+         entropy residual "res" then holds the one of the last solution.
+
+         Parameters:--
+           sols: list of GridFunctions on the space of the solution,
+             updated in place.
+           inits: optional list of GridFunctions with the initial data of
+             each solution, used for inflow boundary conditions. Defaults
+             to the data given to SetInitial.
+           ----------- )"
+	 )
     ;
 }
 
@@ -43,19 +43,20 @@ auto ExportTimeSlab(py::module &m)
          })
     .def("PitchTents",[](shared_ptr<TentPitchedSlab> self,
 			 const double dt,
-			 const bool local_ct, const double global_ct)
+			 const bool local_ct, const double global_ct,
+			 const bool parallel)
 	 {
 	   int dim = self->ma->GetDimension();
 	   bool success = false;
 	   switch(dim){
 	   case 1:
-	     success = self->PitchTents<1>(dt,local_ct,global_ct);
+	     success = self->PitchTents<1>(dt,local_ct,global_ct,parallel);
 	     break;
 	   case 2:
-	     success = self->PitchTents<2>(dt,local_ct,global_ct);
+	     success = self->PitchTents<2>(dt,local_ct,global_ct,parallel);
 	     break;
 	   case 3:
-	     success = self->PitchTents<3>(dt,local_ct,global_ct);
+	     success = self->PitchTents<3>(dt,local_ct,global_ct,parallel);
 	     break;
 	   default:
 	     throw Exception("TentPitchedSlab not available for dimension "+ToString(dim));
@@ -63,6 +64,7 @@ auto ExportTimeSlab(py::module &m)
 	   return success;
 	 },
 	 py::arg("dt"), py::arg("local_ct")=false, py::arg("global_ct")=1.0,
+	 py::arg("parallel")=false,
 	 R"(
          Parameters:--
            dt: spacetime slab's height in time.
@@ -70,10 +72,61 @@ auto ExportTimeSlab(py::module &m)
              with a further local mesh-dependent factor.
            global_ct: an additional factor to constrain tent slope, which
              gives flatter tents for smaller values.
+           parallel: if True, pitch tents concurrently at sets of ready
+             vertices that do not share any neighbour.
 
          Returns True upon successful tent meshing.
          -------------)"
 	 )
+    .def("Save", &TentPitchedSlab::Save, py::arg("filename"),
+	 R"(
+         Write the pitched tents to a binary file. Loading the file is much
+         faster than pitching the slab again.
+
+         Parameters:--
+           filename: name of the file to write.
+         -------------)"
+	 )
+    .def("Load", &TentPitchedSlab::Load, py::arg("filename"),
+         py::arg("dt")=0.0,
+	 R"(
+         Replace the tents by those of a file written by Save. The file must
+         have been written for the same mesh (checked by a hash of the
+         mesh) and pitched with the pitching method of this slab. If a
+         wavespeed has been set, its maximum must be the one the tents
+         were pitched for.
+
+         Parameters:--
+           filename: name of the file to read.
+           dt: if positive, the slab height the tents must have been
+             pitched for.
+         -------------)"
+	 )
+    .def("ReorderTents", [](shared_ptr<TentPitchedSlab> self, string ordering)
+	 {
+	   if (ordering == "pitching")
+	     self->ReorderTents(ngstents::EPitchingOrder);
+	   else if (ordering == "morton")
+	     self->ReorderTents(ngstents::EMortonOrder);
+	   else if (ordering == "rcm")
+	     self->ReorderTents(ngstents::ERCMOrder);
+	   else
+	     throw Exception("unknown tent ordering " + ordering);
+	 },
+	 py::arg("ordering")="morton",
+	 R"(
+         Renumber the pitched tents such that consecutive tents of a level
+         are close in space, which improves the cache reuse of the
+         propagation. Tents of lower levels keep coming first. The
+         conservation laws then propagate a copy of the solution whose
+         dofs are numbered in the order the tents visit them.
+
+         Parameters:--
+           ordering: "morton" sorts by a Morton (Z-order) curve through
+             the central vertices, "rcm" by a reverse Cuthill-McKee
+             numbering of the mesh vertices, "pitching" keeps the order.
+         -------------)"
+	 )
     .def("GetNTents", &TentPitchedSlab::GetNTents)
     .def("GetNLayers", &TentPitchedSlab::GetNLayers)
     .def("GetSlabHeight", &TentPitchedSlab::GetSlabHeight)
@@ -124,6 +177,7 @@ void ExportTents(py::module & m) {
     .def_readonly("nbtime", &Tent::nbtime)
     .def_readonly("els", &Tent::els)
     .def_readonly("level", &Tent::level)
+    .def_readonly("dependent_tents", &Tent::dependent_tents)
     .def_readonly("internal_facets", &Tent::internal_facets)
     .def("MaxSlope", &Tent::MaxSlope);
 
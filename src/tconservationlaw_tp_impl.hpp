@@ -9,6 +9,7 @@ using namespace ngstents;
 
 
 template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <int ORDER>
 void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
 CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
 	     FlatMatrixFixWidth<COMP> u0,
@@ -45,17 +46,34 @@ CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
 	  ud->fel = &fel;
 	  ud->AssignMemory (proxy_u.get(), simd_ir.GetNIP(), COMP, lh);
       	}
-      fel.Evaluate (simd_ir, u.Rows(dn), u_iptsa);
+      EvaluateEl<ORDER> (*fedata, i, u.Rows(dn), u_iptsa);
       Cast().Flux(simd_mir, u_iptsa, flux_iptsa);
 
       FlatVector<SIMD<double>> di = fedata->adelta[i];
       for (auto k : Range(simd_ir.Size()))
-        flux_iptsa.Col(k) *= simd_mir[k].GetWeight() * di(k);
-      fel.AddGradTrans (simd_mir, flux_iptsa, flux.Rows(dn));
+        flux_iptsa.Col(k) *= fedata->GetWeight(i, k) * di(k);
+      AddGradTransEl<ORDER> (*fedata, i, flux_iptsa, flux.Rows(dn), lh);
     }
   }
 
-  {
+  AddFacetFluxTent<ORDER> (tent, u, u0, flux, derive_cf_bnd, lh);
+
+  for (int i : Range (tent.els))
+    SolveM<ORDER> (tent, i, flux.Rows (tent.fedata->ranges[i]), lh);
+
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <int ORDER>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+AddFacetFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
+		 FlatMatrixFixWidth<COMP> u0,
+		 FlatMatrixFixWidth<COMP> flux, int derive_cf_bnd,
+		 LocalHeap & lh)
+{
+  auto fedata = tent.fedata;
+  if (!fedata) throw Exception("fedata not set");
+
   for(int i : Range(tent.internal_facets))
     {
       HeapReset hr(lh);
@@ -88,8 +106,8 @@ CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
 	      ud->AssignMemory (proxy_u.get(), simd_ir_facet_vol1.GetNIP(), COMP, lh);
 	      ud->AssignMemory (proxy_uother.get(), simd_ir_facet_vol1.GetNIP(), COMP, lh);
 	    }
-	  fel1.Evaluate(simd_ir_facet_vol1, u.Rows(dn1), u1);
-	  fel2.Evaluate(simd_ir_facet_vol2, u.Rows(dn2), u2);
+	  EvaluateFacet<ORDER>(*fedata, i, 0, u.Rows(dn1), u1);
+	  EvaluateFacet<ORDER>(*fedata, i, 1, u.Rows(dn2), u2);
 
           FlatMatrix<SIMD<double>> fn(COMP, simd_nipt, lh);
 	  Cast().NumFlux (simd_mir1, u1, u2, fedata->anormals[i], fn);
@@ -98,9 +116,9 @@ CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
           for (size_t j : Range(simd_nipt))
             fn.Col(j) *= -1.0 * di(j) * simd_mir1[j].GetWeight();
 
-          fel1.AddTrans(simd_ir_facet_vol1, fn, flux.Rows(dn1));
+          AddTransFacet<ORDER>(*fedata, i, 0, fn, flux.Rows(dn1));
           fn *= -1.0;
-          fel2.AddTrans(simd_ir_facet_vol2, fn, flux.Rows(dn2));
+          AddTransFacet<ORDER>(*fedata, i, 1, fn, flux.Rows(dn2));
         }
       else
         {
@@ -137,7 +155,7 @@ CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
 	      ud->AssignMemory (proxy_uother.get(), simd_ir_facet_vol1.GetNIP(), COMP, lh);
 	      const_cast<ElementTransformation&>(strafo).userdata = ud;
 	    }
-          fel1.Evaluate(simd_ir_facet_vol1,u.Rows(dn1),u1);
+          EvaluateFacet<ORDER>(*fedata, i, 0, u.Rows(dn1), u1);
           auto & simd_mir = *fedata->mfiri1[i];
 
 	  FlatVector<SIMD<double>> di = fedata->adelta_facet[i];
@@ -153,7 +171,7 @@ CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
             }
           else if (bc == 2) // inflow, use initial data
             {
-              fel1.Evaluate(simd_ir_facet_vol1, u0.Rows(dn1), u2);
+              EvaluateFacet<ORDER>(*fedata, i, 0, u0.Rows(dn1), u2);
             }
           else if (bc == 3) // transparent (wave)
             {
@@ -196,14 +214,9 @@ CalcFluxTent(const Tent & tent, const FlatMatrixFixWidth<COMP> u,
               fn.Col(j) *= fac;
             }
 
-          fel1.AddTrans(simd_ir_facet_vol1, fn, flux.Rows(dn1));
+          AddTransFacet<ORDER>(*fedata, i, 0, fn, flux.Rows(dn1));
         }
     }
-  }
-
-  for (int i : Range (tent.els))
-    SolveM (tent, i, flux.Rows (tent.fedata->ranges[i]), lh);
-
 }
 
 template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
@@ -226,19 +239,14 @@ CalcViscosityTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
     {
       HeapReset hr(lh);
       auto & fel = static_cast<const BaseScalarFiniteElement&> (*fedata->fei[i]);
-      auto & simd_mir = *fedata->miri[i];
-
       IntRange dn = tent.fedata->ranges[i];
 
-      FlatMatrix<SIMD<double>> gradu(DIM,simd_mir.Size(),lh);
-      for(size_t j : Range(COMP))
-        {
-	  fel.EvaluateGrad(simd_mir,u.Col(j).Range(dn),gradu);
-	  for(size_t k : Range(simd_mir.Size()))
-	    gradu.Col(k) *= nu(i) * simd_mir[k].GetWeight();
-
-	  fel.AddGradTrans(simd_mir,gradu,visc.Col(j).Range(dn));
-        }
+      const size_t nipt = fedata->iri[i]->Size();
+      FlatMatrix<SIMD<double>> gradu(DIM*COMP,nipt,lh);
+      EvaluateGradEl (*fedata, i, u.Rows(dn), gradu, lh);
+      for(size_t k : Range(nipt))
+        gradu.Col(k) *= nu(i) * fedata->GetWeight(i, k);
+      AddGradTransEl (*fedata, i, gradu, visc.Rows(dn), lh);
 
       //quick hack for other facets
       auto fnums = ma->GetElFacets (tent.els[i]);
@@ -402,14 +410,16 @@ CalcEntropyResidualTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
 
       auto & simd_mir = *fedata->miri[i];
 
-      auto gradbot = fedata->agradphi_bot[i];
-      auto gradtop = fedata->agradphi_top[i];
-      FlatMatrix<AutoDiff<1,SIMD<double>>> gradphi_mat(DIM, simd_mir.Size(), lh);
+      auto simd_nipt = simd_mir.Size();
+      FlatMatrix<SIMD<double>> gradphi(DIM, simd_nipt, lh), graddelta(DIM, simd_nipt, lh);
+      fedata->GradPhi(i, tstar, gradphi);
+      fedata->GradDelta(i, graddelta);
+      FlatMatrix<AutoDiff<1,SIMD<double>>> gradphi_mat(DIM, simd_nipt, lh);
       for(size_t k : Range(DIM))
-        for(size_t l : Range(simd_mir.Size()))
+        for(size_t l : Range(simd_nipt))
           {
-            gradphi_mat(k,l).Value() = (1-tstar)*gradbot(k,l) + tstar*gradtop(k,l);
-            gradphi_mat(k,l).DValue(0) = gradtop(k,l) - gradbot(k,l);
+            gradphi_mat(k,l).Value() = gradphi(k,l);
+            gradphi_mat(k,l).DValue(0) = graddelta(k,l);
           }
 
       FlatMatrix<SIMD<double>> Ei(ECOMP,simd_ir.Size(),lh), Fi(DIM*ECOMP,simd_ir.Size(),lh);
@@ -425,10 +435,6 @@ CalcEntropyResidualTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
 	  ud->AssignMemory (tps->cfgradphi.get(), nip, DIM, lh);  // cf gradphi
 	  ud->AssignMemory (proxy_graddelta.get(), nip, DIM, lh);  // proxy graddelta
 
-	  auto simd_nipt = simd_mir.Size();
-	  FlatMatrix<SIMD<double>> gradphi(DIM, simd_nipt, lh), graddelta(DIM, simd_nipt, lh);
-	  gradphi = (1-tstar)*gradbot + tstar*gradtop;
-	  graddelta = gradtop - gradbot;
 	  Cast().InverseMap(simd_mir, gradphi, graddelta, ui, uti);
 	  Cast().CalcEntropy(simd_mir, ui, uti, gradphi, graddelta, Ei, Fi);
 	}
@@ -441,8 +447,9 @@ CalcEntropyResidualTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
       FlatVector<SIMD<double>> di = fedata->adelta[i];
       for(size_t k : Range(simd_ir.Size()))
         {
-          Ei(0,k) *= simd_mir[k].GetWeight();
-          auto fac = -1.0 * simd_mir[k].GetWeight() * di(k);
+          auto weight = fedata->GetWeight(i, k);
+          Ei(0,k) *= weight;
+          auto fac = -1.0 * weight * di(k);
           for(size_t l : Range(DIM))
             Fi(l,k) *= fac;
           if(ECOMP>1)
@@ -451,7 +458,7 @@ CalcEntropyResidualTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
         }
 
       fel.AddTrans(simd_ir,Ei,res.Rows(dn));
-      fel.AddGradTrans (simd_mir, Fi, res.Col(0).Range(dn));
+      AddGradTransEl (*fedata, i, Fi, res.Rows(dn), lh);
     }
 
   FlatMatrixFixWidth<COMP> temp(u.Height(),lh);
@@ -629,7 +636,7 @@ CalcViscosityCoefficientTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
       FlatMatrix<SIMD<double>> ui(COMP,simd_ir.Size(),lh);
 
       auto & simd_mir = *fedata->miri[i];
-      double hi = pow(simd_mir[0].GetMeasure()[0]/DIM,1.0/DIM);
+      double hi = pow(fedata->GetMeasure(i)/DIM,1.0/DIM);
       if( fel.Order() > 0 ) hi /= fel.Order();
 
       fel.Evaluate(simd_ir,u.Rows(dn),ui);
@@ -648,8 +655,7 @@ CalcViscosityCoefficientTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
       tempu.Cols(simd_ir.GetNIP(),simd_ir.Size()*SIMD<double>::Size()) = 0.0;
 
       FlatMatrix<SIMD<double>> gradphi_mat(DIM, simd_mir.Size(), lh);
-      gradphi_mat = (1-tstar)*fedata->agradphi_bot[i] +
-                    tstar*fedata->agradphi_top[i];
+      fedata->GradPhi(i, tstar, gradphi_mat);
 
       if constexpr(SYMBOLIC)
 	{
@@ -676,6 +682,7 @@ CalcViscosityCoefficientTent (const Tent & tent, FlatMatrixFixWidth<COMP> u,
 ////////////////////////////////////////////////////////////////
 
 template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <int ORDER>
 void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
 Cyl2Tent (const Tent & tent, double tstar,
 	  const FlatMatrixFixWidth<COMP> uhat,
@@ -700,8 +707,7 @@ Cyl2Tent (const Tent & tent, double tstar,
     //    gradphi_mat[j, k] = grad(φ)[j] (x[k], tstar)
     FlatMatrix<SIMD<double>> u_ipts(COMP, simd_mir.Size(),lh);
     FlatMatrix<SIMD<double>> gradphi_mat(DIM, simd_mir.Size(), lh);
-    gradphi_mat = (1-tstar)*fedata->agradphi_bot[i] +
-      tstar*fedata->agradphi_top[i];
+    fedata->GradPhi(i, tstar, gradphi_mat);
 
     if constexpr(SYMBOLIC) {
       // Make ProxyUserData to embed in mir's trafo with space to store 
@@ -722,21 +728,22 @@ Cyl2Tent (const Tent & tent, double tstar,
       ud->AssignMemory(tps->cfgradphi.get(), nip, DIM, lh);
     }
     
-    fel.Evaluate(simd_mir.IR(), uhat.Rows(dn), u_ipts);
+    EvaluateEl<ORDER>(*fedata, i, uhat.Rows(dn), u_ipts);
     Cast().InverseMap(simd_mir, gradphi_mat, u_ipts);
 
     for(size_t k = 0; k < simd_mir.Size(); k++)
-      u_ipts.Col(k) *= simd_mir[k].GetWeight();
+      u_ipts.Col(k) *= fedata->GetWeight(i, k);
 
     // u[i] += ∑ₖ u_ipts[k] * shape[i]( x[k] )
     u.Rows(dn) = 0.0;  
-    fel.AddTrans(simd_mir.IR(), u_ipts, u.Rows(dn));
+    AddTransEl<ORDER>(*fedata, i, u_ipts, u.Rows(dn));
       
-    SolveM(tent, i, u.Rows (dn), lh);
+    SolveM<ORDER>(tent, i, u.Rows (dn), lh);
   }
 }
 
 template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <int ORDER>
 void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
 ApplyM1 (const Tent & tent, double tstar, FlatMatrixFixWidth<COMP> u,
          FlatMatrixFixWidth<COMP> res, LocalHeap & lh)
@@ -758,7 +765,7 @@ ApplyM1 (const Tent & tent, double tstar, FlatMatrixFixWidth<COMP> u,
                                temp(COMP, simd_ir.Size(), lh);
       FlatMatrix<SIMD<double>> flux(COMP*DIM, simd_ir.Size(), lh);
       FlatMatrix<SIMD<double>> graddelta_mat(DIM, simd_ir.Size(), lh);
-      graddelta_mat = fedata->agradphi_top[i] - fedata->agradphi_bot[i];
+      fedata->GradDelta(i, graddelta_mat);
 
       auto & simd_mir = *fedata->miri[i];
       if constexpr(SYMBOLIC)
@@ -769,27 +776,112 @@ ApplyM1 (const Tent & tent, double tstar, FlatMatrixFixWidth<COMP> u,
 	  ud->fel = &fel;
 	  ud->AssignMemory (proxy_u.get(), simd_ir.GetNIP(), COMP, lh);
 	}
-      fel.Evaluate (simd_ir, u.Rows(dn), u_ipts);
+      EvaluateEl<ORDER> (*fedata, i, u.Rows(dn), u_ipts);
       Cast().Flux(simd_mir,u_ipts,flux);
 
       for(size_t j : Range(simd_ir.Size()))
-        for(size_t l : Range(COMP))
-          {
-            SIMD<double> hsum(0.0);
-            for(size_t k : Range(DIM))
-              {
-                auto graddelta = graddelta_mat(k,j) * simd_mir[j].GetWeight();
-		hsum += graddelta * flux(DIM*l+k,j);
-              }
-            temp(l,j) = hsum;
-          }
-      fel.AddTrans(simd_ir,temp,res.Rows(dn));
+        {
+          auto weight = fedata->GetWeight(i, j);
+          for(size_t l : Range(COMP))
+            {
+              SIMD<double> hsum(0.0);
+              for(size_t k : Range(DIM))
+                hsum += graddelta_mat(k,j) * flux(DIM*l+k,j);
+              temp(l,j) = weight * hsum;
+            }
+        }
+      AddTransEl<ORDER>(*fedata, i, temp, res.Rows(dn));
+
+      SolveM<ORDER> (tent, i, res.Rows (dn), lh);
+    }
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <int ORDER>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+CalcStageTent (const Tent & tent, double tstar, double tstar_flux,
+	       const FlatMatrixFixWidth<COMP> uhat, FlatMatrixFixWidth<COMP> u0,
+	       FlatMatrixFixWidth<COMP> u, FlatMatrixFixWidth<COMP> m1u,
+	       FlatMatrixFixWidth<COMP> flux, int derive_cf_bnd, LocalHeap & lh)
+{
+  // Fused Cyl2Tent, ApplyM1 and volume part of CalcFluxTent: per element,
+  // u is evaluated at the integration points once and the flux computed
+  // once, feeding both the M1 term and the volume flux term.
+  auto fedata = tent.fedata;
+  if (!fedata) throw Exception("fedata not set");
+
+  *(tent.time) = tent.timebot + tstar_flux*(tent.ttop-tent.tbot);
+
+  flux = 0.0;
+  for (size_t i : Range(tent.els))
+    {
+      HeapReset hr(lh);
+      auto & fel = static_cast<const BaseScalarFiniteElement&> (*fedata->fei[i]);
 
-      SolveM (tent, i, res.Rows (dn), lh);
+      const SIMD_IntegrationRule & simd_ir = *fedata->iri[i];
+      auto & simd_mir = *fedata->miri[i];
+      IntRange dn = fedata->ranges[i];
+      const size_t nipt = simd_ir.Size();
+
+      FlatMatrix<SIMD<double>> u_ipts(COMP, nipt, lh),
+                               temp(COMP, nipt, lh);
+      FlatMatrix<SIMD<double>> flux_ipts(COMP*DIM, nipt, lh);
+      FlatMatrix<SIMD<double>> gradphi_mat(DIM, nipt, lh);
+      FlatMatrix<SIMD<double>> graddelta_mat(DIM, nipt, lh);
+      fedata->GradPhi(i, tstar, gradphi_mat);
+      fedata->GradDelta(i, graddelta_mat);
+
+      if constexpr(SYMBOLIC)
+	{
+	  ProxyUserData * ud = new (lh) ProxyUserData(1, 1, lh);
+	  auto & trafo = *fedata->trafoi[i];
+	  const_cast<ElementTransformation&>(trafo).userdata = ud;
+	  ud->fel = &fel;
+	  ud->AssignMemory (proxy_u.get(), simd_ir.GetNIP(), COMP, lh);
+	  ud->AssignMemory (tps->cfgradphi.get(), simd_ir.GetNIP(), DIM, lh);
+	}
+
+      // u = Cyl2Tent(uhat) on this element
+      EvaluateEl<ORDER> (*fedata, i, uhat.Rows(dn), u_ipts);
+      Cast().InverseMap(simd_mir, gradphi_mat, u_ipts);
+      for (size_t k : Range(nipt))
+        u_ipts.Col(k) *= fedata->GetWeight(i, k);
+      u.Rows(dn) = 0.0;
+      AddTransEl<ORDER> (*fedata, i, u_ipts, u.Rows(dn));
+      SolveM<ORDER> (tent, i, u.Rows(dn), lh);
+
+      EvaluateEl<ORDER> (*fedata, i, u.Rows(dn), u_ipts);
+      Cast().Flux(simd_mir, u_ipts, flux_ipts);
+
+      FlatVector<SIMD<double>> di = fedata->adelta[i];
+      for (size_t j : Range(nipt))
+        {
+          auto weight = fedata->GetWeight(i, j);
+          for (size_t l : Range(COMP))
+            {
+              SIMD<double> hsum(0.0);
+              for (size_t k : Range(DIM))
+                hsum += graddelta_mat(k,j) * flux_ipts(DIM*l+k,j);
+              temp(l,j) = weight * hsum;
+            }
+          flux_ipts.Col(j) *= weight * di(j);
+        }
+
+      m1u.Rows(dn) = 0.0;
+      AddTransEl<ORDER> (*fedata, i, temp, m1u.Rows(dn));
+      SolveM<ORDER> (tent, i, m1u.Rows(dn), lh);
+
+      AddGradTransEl<ORDER> (*fedata, i, flux_ipts, flux.Rows(dn), lh);
     }
+
+  AddFacetFluxTent<ORDER> (tent, u, u0, flux, derive_cf_bnd, lh);
+
+  for (int i : Range (tent.els))
+    SolveM<ORDER> (tent, i, flux.Rows (fedata->ranges[i]), lh);
 }
 
 template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <int ORDER>
 void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
 Tent2Cyl (const Tent & tent, double tstar,
 	  FlatMatrixFixWidth<COMP> u, FlatMatrixFixWidth<COMP> uhat,
@@ -814,8 +906,7 @@ Tent2Cyl (const Tent & tent, double tstar,
       FlatMatrix<SIMD<double>> flux(COMP*DIM, simd_ir.Size(), lh),
                                res(COMP, simd_ir.Size(), lh);
       FlatMatrix<SIMD<double>> gradphi_mat(DIM, simd_ir.Size(), lh);
-      gradphi_mat = (1-tstar)*fedata->agradphi_bot[i] +
-                    tstar*fedata->agradphi_top[i];
+      fedata->GradPhi(i, tstar, gradphi_mat);
 
       auto & simd_mir = *fedata->miri[i];
       if constexpr(SYMBOLIC)
@@ -826,24 +917,24 @@ Tent2Cyl (const Tent & tent, double tstar,
 	  ud->fel = &fel;
 	  ud->AssignMemory (proxy_u.get(), simd_ir.GetNIP(), COMP, lh);
 	}
-      fel.Evaluate (simd_ir, u.Rows(dn), u_ipts);
+      EvaluateEl<ORDER> (*fedata, i, u.Rows(dn), u_ipts);
       Cast().Flux(simd_mir,u_ipts,flux);
 
       for(size_t j : Range(simd_ir.Size()))
-        for(size_t l : Range(COMP))
-          {
-            SIMD<double> hsum(0.0);
-            for(size_t k : Range(DIM))
-              {
-                auto gradphi = gradphi_mat(k,j) * simd_mir[j].GetWeight();
-		hsum += gradphi * flux(DIM*l+k,j);
-              }
-            res(l,j) = u_ipts(l,j) * simd_mir[j].GetWeight() - hsum;
-          }
+        {
+          auto weight = fedata->GetWeight(i, j);
+          for(size_t l : Range(COMP))
+            {
+              SIMD<double> hsum(0.0);
+              for(size_t k : Range(DIM))
+                hsum += gradphi_mat(k,j) * flux(DIM*l+k,j);
+              res(l,j) = weight * (u_ipts(l,j) - hsum);
+            }
+        }
 
-      fel.AddTrans(simd_ir,res,uhat.Rows(dn));
+      AddTransEl<ORDER>(*fedata, i, res, uhat.Rows(dn));
       if(solvemass)
-	SolveM (tent, i, uhat.Rows (dn), lh);
+	SolveM<ORDER> (tent, i, uhat.Rows (dn), lh);
     }
 }
 
@@ -854,24 +945,552 @@ Tent2Cyl (const Tent & tent, double tstar,
 
 template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
 void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
-Propagate(LocalHeap & lh, shared_ptr<GridFunction> hdgf)
+UpdateTentDofs()
+{
+  if (geomdata->dofmap_version == tps->GetSlabVersion())
+    return;
+  geomdata->dofmap_version = tps->GetSlabVersion();
+  auto & dofmap = geomdata->dofmap;
+  dofmap.SetSize0();
+  u_tent = uinit_tent = res_tent = nullptr;
+  if (tps->GetOrdering() == ngstents::EPitchingOrder)
+    return;
+
+  dofmap.SetSize(fes->GetNDof());
+  dofmap = -1;
+  int pos = 0;
+  Array<int> dnums;
+  for (size_t i : Range(tps->GetNTents()))
+    for (auto el : tps->GetTent(i).els)
+      {
+        fes->GetDofNrs(ElementId(VOL, el), dnums);
+        for (auto d : dnums)
+          if (dofmap[d] == -1)
+            dofmap[d] = pos++;
+      }
+  for (auto & d : dofmap)
+    if (d == -1)
+      d = pos++;
+  u_tent = u->CreateVector();
+  uinit_tent = u->CreateVector();
+  if (ECOMP > 0)
+    res_tent = gfres->GetVector().CreateVector();
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+CopyResidualTentOrder(bool back)
+{
+  // the tents write the entropy residual by the tent-ordered dofs, gfres
+  // is renumbered in place (through res_tent)
+  if (ECOMP == 0)
+    return;
+  BaseVector & res = gfres->GetVector();
+  if (back)
+    {
+      *res_tent = res;
+      CopyTentOrder(res, *res_tent, true);
+    }
+  else
+    {
+      CopyTentOrder(res, *res_tent, false);
+      res = *res_tent;
+    }
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+CopyTentOrder(BaseVector & vec, BaseVector & vec_tent, bool back) const
+{
+  FlatArray<int> dofmap = geomdata->dofmap;
+  auto fv = vec.FVDouble();
+  auto fvt = vec_tent.FVDouble();
+  const size_t es = vec.EntrySize();
+  ParallelForRange
+    (dofmap.Size(), [&] (IntRange r)
+     {
+       for (auto d : r)
+         {
+           auto v = fv.Range(es*d, es*(d+1));
+           auto vt = fvt.Range(es*dofmap[d], es*(dofmap[d]+1));
+           if (back)
+             v = vt;
+           else
+             vt = v;
+         }
+     });
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+BuildPropagators(LocalHeap & lh)
+{
+  if (cf_bnd.Size())
+    throw Exception("Precomputed propagators are not available with "
+                    "boundary coefficient functions");
+
+  const size_t ntents = tps->GetNTents();
+  TableCreator<int> create_dofs(ntents);
+  Array<int> dnums;
+  for ( ; !create_dofs.Done(); create_dofs++)
+    for (size_t i : Range(ntents))
+      for (auto el : tps->GetTent(i).els)
+        {
+          fes->GetDofNrs(ElementId(VOL, el), dnums);
+          for (auto d : dnums)
+            create_dofs.Add(i, d);
+        }
+  propagator_dofs = create_dofs.MoveTable();
+
+  propagator.SetSize(ntents);
+  propagator_bnd.SetSize(ntents);
+  ParallelFor
+    (ntents, [&] (size_t i)
+     {
+       LocalHeap slh = lh.Split();
+       Tent tent = tps->GetTent(i);
+       // do not touch the global advancing front while probing
+       double time = 0.0;
+       tent.time = &time;
+       tent.timebot = 0.0;
+       if (fedata_cache)
+         tent.fedata = fedata_cache->Get(i);
+       if (!tent.fedata)
+         tent.fedata = new (slh) TentDataFE(tent, *geomdata, slh);
+
+       const size_t n = tent.fedata->nd * COMP;
+       FlatVector<> uhat(n, slh), u0(n, slh);
+       Matrix<> & prop = propagator[i];
+       Matrix<> & prop_bnd = propagator_bnd[i];
+       prop.SetSize(n, n);
+       prop_bnd.SetSize(n, n);
+       bool inflow = false;
+       for (size_t j : Range(n))
+         {
+           uhat = 0.0;
+           uhat(j) = 1.0;
+           u0 = 0.0;
+           tentsolver->PropagateLocal(tent, uhat, u0, slh);
+           prop.Col(j) = uhat;
+
+           uhat = 0.0;
+           u0(j) = 1.0;
+           tentsolver->PropagateLocal(tent, uhat, u0, slh);
+           prop_bnd.Col(j) = uhat;
+           if (L2Norm(uhat) > 0.0)
+             inflow = true;
+         }
+       // the initial data only enters through inflow boundaries
+       if (!inflow)
+         prop_bnd.SetSize(0, 0);
+     });
+  propagator_version = tps->GetSlabVersion();
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+const Table<int> & T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+GetMultiSlabDependency(int nslabs)
+{
+  if (multislab_nslabs == nslabs && multislab_version == tps->GetSlabVersion())
+    return multislab_dependency;
+
+  const int ntents = tps->GetNTents();
+  auto & slab_dependency = tps->slab_dependency;
+  TableCreator<int> create_dag(nslabs*ntents);
+  for ( ; !create_dag.Done(); create_dag++)
+    for (int s : Range(nslabs))
+      for (int i : Range(ntents))
+        {
+          for (int d : tent_dependency[i])
+            create_dag.Add(s*ntents+i, s*ntents+d);
+          if (s+1 < nslabs)
+            for (int d : slab_dependency[i])
+              create_dag.Add(s*ntents+i, (s+1)*ntents+d);
+        }
+  multislab_dependency = create_dag.MoveTable();
+  multislab_nslabs = nslabs;
+  multislab_version = tps->GetSlabVersion();
+  return multislab_dependency;
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+const ngstents::StaticSchedule & T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+GetStaticSchedule(int nslabs)
+{
+  const int nthreads = task_manager ? task_manager->GetNumThreads() : 1;
+  if (static_schedule_nslabs == nslabs &&
+      static_schedule_version == tps->GetSlabVersion() &&
+      static_schedule.nthreads == nthreads)
+    return static_schedule;
+
+  // the work of a tent grows with the number of its elements
+  const int ntents = tps->GetNTents();
+  Array<double> cost(nslabs*ntents);
+  for (int i : Range(cost))
+    cost[i] = tps->GetTent(i % ntents).els.Size();
+
+  const Table<int> & dag =
+    (nslabs > 1) ? GetMultiSlabDependency(nslabs) : tent_dependency;
+  static_schedule = ngstents::ComputeStaticSchedule(dag, cost, nthreads);
+  static_schedule_nslabs = nslabs;
+  static_schedule_version = tps->GetSlabVersion();
+  return static_schedule;
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+FlatArray<int> T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+GetPriorityBands(int nslabs)
+{
+  if (priority_nslabs == nslabs && priority_version == tps->GetSlabVersion())
+    return priority_bands;
+
+  const int ntents = tps->GetNTents();
+  Array<double> cost(nslabs*ntents);
+  for (int i : Range(cost))
+    cost[i] = tps->GetTent(i % ntents).els.Size();
+
+  const Table<int> & dag =
+    (nslabs > 1) ? GetMultiSlabDependency(nslabs) : tent_dependency;
+  priority_bands = ngstents::PriorityBands
+    (ngstents::ComputeBottomLevels(dag, cost));
+  priority_nslabs = nslabs;
+  priority_version = tps->GetSlabVersion();
+  return priority_bands;
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+const ngstents::CoarseDependency & T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+GetCoarseDependency(int nslabs)
+{
+  if (coarse_nslabs == nslabs && coarse_version == tps->GetSlabVersion() &&
+      coarse_threshold == agglomeration)
+    return coarse_dependency;
+
+  const int ntents = tps->GetNTents();
+  Array<double> cost(nslabs*ntents);
+  for (int i : Range(cost))
+    cost[i] = tps->GetTent(i % ntents).els.Size();
+
+  const Table<int> & dag =
+    (nslabs > 1) ? GetMultiSlabDependency(nslabs) : tent_dependency;
+  coarse_dependency = ngstents::CoarsenDependency(dag, cost, agglomeration);
+  coarse_nslabs = nslabs;
+  coarse_version = tps->GetSlabVersion();
+  coarse_threshold = agglomeration;
+  return coarse_dependency;
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <typename TFUNC>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+RunTents(int nslabs, TFUNC tentfunc)
+{
+  const int ntents = tps->GetNTents();
+
+  // count heap allocations inside the tents (see ThreadAllocations)
+  atomic<size_t> allocations(0);
+  auto func = [&] (int tentnr)
+    {
+      const size_t before = ngstents::ThreadAllocations();
+      tentfunc(tentnr);
+      if (size_t n = ngstents::ThreadAllocations() - before)
+        allocations += n;
+    };
+
+  switch (scheduler)
+    {
+    case ngstents::ELevelScheduler:
+      {
+        // one barrier per layer, no synchronization within a layer
+        ngstents::SchedulerStats stats;
+        scheduler_stats = ngstents::SchedulerStats();
+        for (int s : Range(nslabs))
+          {
+            RunLevelSynchronous
+              (tps->tent_layers, [&] (int i) { func(s*ntents+i); }, &stats);
+            scheduler_stats.Add(stats);
+          }
+        break;
+      }
+    case ngstents::EStaticScheduler:
+      {
+        // replay the schedule computed once for this slab
+        const auto & schedule = GetStaticSchedule(nslabs);
+        const Table<int> & dag =
+          (nslabs > 1) ? GetMultiSlabDependency(nslabs) : tent_dependency;
+        RunStaticSchedule(dag, schedule, func, &scheduler_stats);
+        break;
+      }
+    case ngstents::EPriorityScheduler:
+      {
+        // tents on the critical path of the slab are started first
+        auto bands = GetPriorityBands(nslabs);
+        const Table<int> & dag =
+          (nslabs > 1) ? GetMultiSlabDependency(nslabs) : tent_dependency;
+        RunParallelDependency(dag, func, &scheduler_stats, bands);
+        break;
+      }
+    default:
+      {
+        if (agglomeration > 0)
+          {
+            // one task per cluster of tents, processed serially
+            const auto & coarse = GetCoarseDependency(nslabs);
+            RunParallelDependency
+              (coarse.dag, [&] (int c)
+               {
+                 for (int tentnr : coarse.clusters[c])
+                   func(tentnr);
+               }, &scheduler_stats);
+            break;
+          }
+        const Table<int> & dag =
+          (nslabs > 1) ? GetMultiSlabDependency(nslabs) : tent_dependency;
+        RunParallelDependency(dag, func, &scheduler_stats);
+      }
+    }
+  scheduler_stats.allocations = allocations;
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+Propagate(LocalHeap & lh, shared_ptr<GridFunction> hdgf, int nslabs)
 {
   // static Timer tprop ("Propagate", 2); RegionTimer reg(tprop);
 
+  if (nslabs < 1)
+    throw Exception("Propagate needs at least one slab");
+  if (hdgf != nullptr && nslabs > 1)
+    throw Exception("3D visualization needs one Propagate call per slab");
+
   if (hdgf != nullptr)
       vis3d->SetInitialHd(gfu, hdgf, lh);
 
   tentsolver->Setup();
 
-  RunParallelDependency
-    (tent_dependency, [&] (int i)
+  if (!geomdata)
+    geomdata = make_shared<MeshGeometryData>(fes, SYMBOLIC,
+                                              Cast().UsesMappedPoints());
+  // the cached tent data refers to the dof numbers
+  UpdateTentDofs();
+
+  if (fedata_cache && !fedata_cache->IsValid(*tps))
+    fedata_cache->Build(*tps, *geomdata);
+
+  const int ntents = tps->GetNTents();
+
+  if (use_propagator)
+    {
+      if (propagator_version != tps->GetSlabVersion())
+        BuildPropagators(lh);
+
+      RunTents
+        (nslabs, [&] (int tentnr)
+         {
+           const int i = tentnr % ntents;
+           LocalHeap slh = lh.Split();  // split to threads
+           Tent tent = tps->GetTent(i);
+           tent.InitTent(gftau);
+           auto dofs = propagator_dofs[i];
+           const size_t n = dofs.Size() * COMP;
+           FlatVector<> ubot(n, slh), utop(n, slh);
+           u->GetIndirect(dofs, ubot);
+           utop = propagator[i] * ubot;
+           if (propagator_bnd[i].Height())
+             {
+               uinit->GetIndirect(dofs, ubot);
+               utop += propagator_bnd[i] * ubot;
+             }
+           u->SetIndirect(dofs, utop);
+           tent.SetFinalTime();
+           if (hdgf != nullptr)
+             vis3d->SetForTent(tent, gfu, hdgf, slh);
+         });
+      return;
+    }
+
+  // with reordered tents the tent-ordered copies are propagated
+  const bool tentorder = geomdata->dofmap.Size();
+  if (tentorder)
+    {
+      CopyTentOrder(*u, *u_tent, false);
+      CopyTentOrder(*uinit, *uinit_tent, false);
+      CopyResidualTentOrder(false);
+    }
+  BaseVector & hu = tentorder ? *u_tent : *u;
+  BaseVector & hu0 = tentorder ? *uinit_tent : *uinit;
+
+  RunTents
+    (nslabs, [&] (int tentnr)
      {
+       const int i = tentnr % ntents;
        LocalHeap slh = lh.Split();  // split to threads
        Tent tent = tps->GetTent(i);
-       tentsolver->PropagateTent(tent, *u, *uinit, slh);
+       if (fedata_cache)
+         tent.fedata = fedata_cache->Get(i);
+       tentsolver->PropagateTent(tent, hu, hu0, slh);
        if (hdgf != nullptr)
-         vis3d->SetForTent(tent, gfu, hdgf, slh);
+         {
+           if (tentorder)
+             {
+               // the visualization reads the dofs of the tent from u
+               Array<int> dnums;
+               auto fv = u->FVDouble(), fvt = hu.FVDouble();
+               for (auto el : tent.els)
+                 {
+                   fes->GetDofNrs(ElementId(VOL, el), dnums);
+                   for (auto d : dnums)
+                     fv.Range(COMP*d, COMP*(d+1)) =
+                       fvt.Range(COMP*geomdata->dofmap[d],
+                                 COMP*(geomdata->dofmap[d]+1));
+                 }
+             }
+           vis3d->SetForTent(tent, gfu, hdgf, slh);
+         }
+     });
+
+  if (tentorder)
+    {
+      CopyTentOrder(*u, *u_tent, true);
+      CopyResidualTentOrder(true);
+    }
+}
+
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+PropagateEnsemble(LocalHeap & lh, FlatArray<shared_ptr<BaseVector>> us,
+                  FlatArray<shared_ptr<BaseVector>> uinits)
+{
+  const size_t nens = us.Size();
+  if (uinits.Size() && uinits.Size() != nens)
+    throw Exception("PropagateEnsemble needs one initial data vector "
+                    "per solution vector");
+  for (auto & vec : us)
+    if (vec->Size() != u->Size())
+      throw Exception("PropagateEnsemble: vector does not match the space");
+  auto GetInit = [&] (size_t k) -> const BaseVector &
+    { return uinits.Size() ? *uinits[k] : *uinit; };
+
+  tentsolver->Setup();
+
+  if (!use_propagator)
+    {
+      PropagateEnsembleLocal(lh, us, GetInit);
+      return;
+    }
+
+  if (propagator_version != tps->GetSlabVersion())
+    {
+      if (!geomdata)
+        geomdata = make_shared<MeshGeometryData>(fes, SYMBOLIC,
+                                                  Cast().UsesMappedPoints());
+      UpdateTentDofs();
+      if (fedata_cache && !fedata_cache->IsValid(*tps))
+        fedata_cache->Build(*tps, *geomdata);
+      BuildPropagators(lh);
+    }
+
+  RunTents
+    (1, [&] (int i)
+     {
+       LocalHeap slh = lh.Split();  // split to threads
+       Tent tent = tps->GetTent(i);
+       tent.InitTent(gftau);
+       // one matrix-matrix product for all members of the ensemble
+       auto dofs = propagator_dofs[i];
+       const size_t n = dofs.Size() * COMP;
+       FlatMatrix<> ubot(n, nens, slh), utop(n, nens, slh);
+       FlatVector<> hv(n, slh);
+       for (size_t k : Range(nens))
+         {
+           us[k]->GetIndirect(dofs, hv);
+           ubot.Col(k) = hv;
+         }
+       utop = propagator[i] * ubot;
+       if (propagator_bnd[i].Height())
+         {
+           for (size_t k : Range(nens))
+             {
+               GetInit(k).GetIndirect(dofs, hv);
+               ubot.Col(k) = hv;
+             }
+           utop += propagator_bnd[i] * ubot;
+         }
+       for (size_t k : Range(nens))
+         {
+           hv = utop.Col(k);
+           us[k]->SetIndirect(dofs, hv);
+         }
+       tent.SetFinalTime();
      });
 }
 
+template <typename EQUATION, int DIM, int COMP, int ECOMP, bool SYMBOLIC>
+template <typename TINIT>
+void T_ConservationLaw<EQUATION, DIM, COMP, ECOMP, SYMBOLIC>::
+PropagateEnsembleLocal(LocalHeap & lh, FlatArray<shared_ptr<BaseVector>> us,
+                       TINIT GetInit)
+{
+  if (!geomdata)
+    geomdata = make_shared<MeshGeometryData>(fes, SYMBOLIC,
+                                              Cast().UsesMappedPoints());
+  UpdateTentDofs();
+  if (fedata_cache && !fedata_cache->IsValid(*tps))
+    fedata_cache->Build(*tps, *geomdata);
+
+  // the members are numbered as the mesh, the tent data possibly by the
+  // tent order
+  const bool tentorder = geomdata->dofmap.Size();
+  CopyResidualTentOrder(false);
+
+  RunTents
+    (1, [&] (int i)
+     {
+       LocalHeap slh = lh.Split();  // split to threads
+       Tent tent = tps->GetTent(i);
+       if (fedata_cache)
+         tent.fedata = fedata_cache->Get(i);
+       if (!tent.fedata)
+         tent.fedata = new (slh) TentDataFE(tent, *geomdata, slh);
+       const TentDataFE & fedata = *tent.fedata;
+       tent.InitTent(gftau);
+
+       FlatArray<int> dofs = fedata.dofs;
+       if (tentorder)
+         {
+           dofs.Assign(fedata.nd, slh);
+           for (size_t k : Range(tent.els))
+             {
+               Array<int> dnums(fedata.ranges[k].Size(),
+                                dofs.Data() + fedata.ranges[k].First());
+               fes->GetDofNrs(ElementId(VOL, tent.els[k]), dnums);
+             }
+         }
+       // the tent data is set up once and shared by all members
+       const size_t n = fedata.nd * COMP;
+       FlatVector<> uhat(n, slh), u0(n, slh);
+       for (size_t k : Range(us))
+         {
+           if (tentorder)
+             {
+               us[k]->GetIndirect(dofs, uhat);
+               GetInit(k).GetIndirect(dofs, u0);
+             }
+           else
+             {
+               fedata.GatherDofs(*us[k], uhat);
+               fedata.GatherDofs(GetInit(k), u0);
+             }
+           tentsolver->PropagateLocal(tent, uhat, u0, slh);
+           if (tentorder)
+             us[k]->SetIndirect(dofs, uhat);
+           else
+             fedata.ScatterDofs(*us[k], uhat);
+         }
+       tent.SetFinalTime();
+     });
+
+  CopyResidualTentOrder(true);
+}
+
 #endif // CONSERVATIONLAW_TP_IMPL
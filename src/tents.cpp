@@ -1,8 +1,109 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
 #include <limits>
+#include <new>
 
 #include "tents.hpp"
 
 
+#ifdef NGSTENTS_COUNT_ALLOCATIONS
+// debugging aid: count the calls of the global operator new per thread.
+// All throwing, nothrow and aligned forms are replaced (the sized forms
+// only exist for delete), together with the matching deletes, so memory
+// is always released by the allocator that provided it.
+static thread_local size_t thread_allocations = 0;
+
+static void * CountedAlloc (size_t size, size_t align)
+{
+  thread_allocations++;
+  if (align <= alignof(std::max_align_t))
+    return malloc(size ? size : 1);
+  return aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+void * operator new (size_t size)
+{
+  if (void * p = CountedAlloc(size, 0))
+    return p;
+  throw std::bad_alloc();
+}
+
+void * operator new[] (size_t size)
+{
+  return ::operator new (size);
+}
+
+void * operator new (size_t size, const std::nothrow_t &) noexcept
+{
+  return CountedAlloc(size, 0);
+}
+
+void * operator new[] (size_t size, const std::nothrow_t &) noexcept
+{
+  return CountedAlloc(size, 0);
+}
+
+void * operator new (size_t size, std::align_val_t al)
+{
+  if (void * p = CountedAlloc(size, size_t(al)))
+    return p;
+  throw std::bad_alloc();
+}
+
+void * operator new[] (size_t size, std::align_val_t al)
+{
+  return ::operator new (size, al);
+}
+
+void * operator new (size_t size, std::align_val_t al,
+                     const std::nothrow_t &) noexcept
+{
+  return CountedAlloc(size, size_t(al));
+}
+
+void * operator new[] (size_t size, std::align_val_t al,
+                       const std::nothrow_t &) noexcept
+{
+  return CountedAlloc(size, size_t(al));
+}
+
+void operator delete (void * p) noexcept { free(p); }
+void operator delete[] (void * p) noexcept { free(p); }
+void operator delete (void * p, size_t) noexcept { free(p); }
+void operator delete[] (void * p, size_t) noexcept { free(p); }
+void operator delete (void * p, std::align_val_t) noexcept { free(p); }
+void operator delete[] (void * p, std::align_val_t) noexcept { free(p); }
+void operator delete (void * p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[] (void * p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete (void * p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[] (void * p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete (void * p, std::align_val_t,
+                      const std::nothrow_t &) noexcept { free(p); }
+void operator delete[] (void * p, std::align_val_t,
+                        const std::nothrow_t &) noexcept { free(p); }
+#endif
+
+size_t ngstents::ThreadAllocations()
+{
+#ifdef NGSTENTS_COUNT_ALLOCATIONS
+  return thread_allocations;
+#else
+  return 0;
+#endif
+}
+
+bool ngstents::CountsAllocations()
+{
+#ifdef NGSTENTS_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
 
 ///////////////////// GradPhiCoefficientFunction ///////////////////////////
 
@@ -75,13 +176,41 @@ constexpr ngfem::ELEMENT_TYPE EL_TYPE(int DIM)
   return DIM == 1 ? ET_SEGM : DIM == 2 ? ET_TRIG : ET_TET;
 }//this assumes that there is only one type of element per mesh
 
+// copy the rows get(i), i < n, into one table
+template <typename T, typename FUNC>
+static Table<T> FlattenRows (size_t n, FUNC get)
+{
+  Array<int> cnt(n);
+  ParallelFor (n, [&] (size_t i) { cnt[i] = get(i).Size(); });
+  Table<T> table(cnt);
+  ParallelFor
+    (n, [&] (size_t i)
+     {
+       auto src = get(i);
+       auto dst = table[i];
+       for (size_t k = 0; k < src.Size(); k++)
+         dst[k] = src[k];
+     });
+  return table;
+}
+
+
+// A tent while its slab is being pitched: the arrays grow with the
+// pitching and are flattened into the tables of the slab afterwards
+struct PitchedTent
+{
+  int vertex, level;
+  double tbot, ttop;
+  Array<int> nbv, els, internal_facets, dependent_tents;
+  Array<double> nbtime;
+};
+
 template <int DIM>
-bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, const double global_ct)
+bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, const double global_ct,
+                                 const bool parallel)
 {
-  if(has_been_pitched)
-    {
-      tents.DeleteAll();
-    }
+  // also drops the tents of an incomplete earlier attempt
+  ReleaseTents();
   if(cmax == nullptr)
     {
       throw std::logic_error("Wavespeed has not been set!");
@@ -107,6 +236,7 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
   //calc wavespeed for each element and perhaps other stuff (i..e, calculating edge gradients, checking fine edges, etc)
   Table<int> v2v, v2e;
   std::tie(v2v,v2e) = slabpitcher->InitializeMeshData<DIM>(lh,cmax, calc_local_ct, global_ct);
+  max_wavespeed = MaxWavespeed();
   
   Array<double> tau(ma->GetNV());  // advancing front values at vertices
   tau = 0.0;
@@ -131,11 +261,8 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
   double adv_factor{0.5};
   //whether to reset the adv_factor to its initial value after populating ready_vertices
   constexpr bool reset_adv_factor = true;
-  // array of vertices ready for pitching a tent
-  Array<int> ready_vertices;
-  // array for checking if a given vertex is ready
-  BitArray vertex_ready(ma->GetNV());
-  vertex_ready.Clear();
+  // vertices ready for pitching a tent, bucketed by level
+  ReadyVertexQueue ready_vertices(ma->GetNV());
   bool slab_complete{false};
   //array for checking if a given vertex is complete (tau[vi] = dt)
   BitArray complete_vertices(ma->GetNV());
@@ -143,12 +270,110 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
   //numerical tolerance
   const double num_tol = std::numeric_limits<double>::epsilon() * dt;
 
+  // the tents pitched so far, moved into the slab at the end
+  Array<PitchedTent*> pitched;
+
+  // Pitch a tent at vertex vi and store it in pitched[tentnr]. Returns
+  // true if the tent reaches the top of the slab. Only data belonging to
+  // vi and its neighbours is modified (and tents pitched at these
+  // neighbours), so vertices at distance > 2 can be pitched concurrently.
+  auto pitch_tent = [&] (const int vi, const int tentnr) -> bool
+    {
+      //current tent
+      PitchedTent * tent = pitched[tentnr];
+      tent->vertex = vi;
+      tent->tbot = tau[vi];
+
+      bool vertex_complete = false;
+      const auto new_ttop = tau[vi] + ktilde[vi];
+      if(dt - new_ttop > num_tol)
+        {//not close to the end of the time slab
+          tent->ttop = new_ttop;
+        }
+      else
+        {//vertex is complete
+          tent->ttop = dt;
+          vertex_complete = true;
+        }
+      //let us ignore this for now
+      // else if(new_ttop >= dt)
+      //   {//vertex is complete
+      //     tent->ttop = dt;
+      //     complete_vertices[vi] = true;
+      //   }
+      // else
+      //   {//vertex is really close to the end of time slab.
+      //     //in this scenario, we might want to pitch a lower
+      //     //tent to avoid numerical issues with degenerate tents
+      //     tent->ttop = ktilde[vi] * 0.75 + tau[vi];
+      //   }
+
+      tent->level = vertices_level[vi]; // 0;
+      tau[vi] = tent->ttop;
+      ktilde[vi] = 0;//assuming that ktilde[vi] was the maximum advance
+
+      //add neighboring vertices and update their level
+      for (int nb : v2v[vi])
+        {
+          nb = vmap[nb]; // only update main vertex if periodic
+          tent->nbv.Append (nb);
+          tent->nbtime.Append (tau[nb]);
+          //update level of vertices if needed
+          if(vertices_level[nb] < tent->level + 1)
+            vertices_level[nb] = tent->level + 1;
+          // tent number is just array index in tents
+          if (latest_tent[nb] != -1)
+            pitched[latest_tent[nb]]->dependent_tents.Append (tentnr);
+        }
+      latest_tent[vi] = tentnr;
+      vertices_level[vi]++;
+
+      // Set tent internal facets
+      if(DIM==1)
+        // vertex itself represents the only internal edge/facet
+        tent->internal_facets.Append (vi);
+      else if (DIM == 2)
+        for (int e : v2e[vi]) tent->internal_facets.Append (e);
+      else
+        {
+          // DIM == 3 => internal facets are faces
+          //points contained in a given facet
+          ArrayMem<int,4> fpnts;
+          ArrayMem<int,30> vertex_els;
+          slabpitcher->GetVertexElements(vi,vertex_els);
+          for (auto elnr : vertex_els)
+            for (auto f : ma->GetElement(ElementId(VOL,elnr)).Faces())
+              {
+                //get facet vertices
+                ma->GetFacetPNums(f, fpnts);
+                for (auto f_v : fpnts)
+                  {
+                    if (vmap[f_v]  == vi &&
+                        !tent->internal_facets.Contains(f))
+                      {
+                        tent->internal_facets.Append(f);
+                        break;
+                      }
+                  }
+              }
+        }
+      slabpitcher->GetVertexElements(vi,tent->els);
+      return vertex_complete;
+    };
+
+  // used in parallel mode for selecting independent vertices
+  BitArray touched_vertices(ma->GetNV());
+  touched_vertices.Clear();
+  Array<int> indep_vertices;
+  Array<bool> indep_complete;
+
   while ( !slab_complete )
     {
       // cout << "Setting ready vertices" << endl;
 
       const bool found_vertices =
-        slabpitcher->GetReadyVertices(adv_factor,reset_adv_factor,ktilde,complete_vertices, vertex_ready,ready_vertices);
+        slabpitcher->GetReadyVertices(adv_factor,reset_adv_factor,ktilde,
+                                      vertices_level,ready_vertices);
       //no possible vertex in which a tent could be pitched was found
       if(!found_vertices) break;
       // ---------------------------------------------
@@ -157,108 +382,59 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
 
       // cout << "Pitching tents..." << endl;
       
-      while (ready_vertices.Size())
+      while (ready_vertices.Size() && !parallel)
         {
-          int minlevel, posmin;
-          std::tie(minlevel,posmin) =
-            slabpitcher->PickNextVertexForPitching(ready_vertices,ktilde,vertices_level);
+          //vi: vertex index at which the current tent is being pitched
+          int minlevel, vi;
+          std::tie(minlevel,vi) =
+            slabpitcher->PickNextVertexForPitching(ready_vertices);
           nlayers = max(minlevel,nlayers);
-          //vertex index at which the current tent is being pitched
-          const int vi = ready_vertices[posmin];
-          ready_vertices.DeleteElement(posmin);
-          vertex_ready.Clear(vi);
-
-          //current tent
-          Tent * tent = new Tent(vmap);
-          tent->vertex = vi;
-          tent->tbot = tau[vi];
-
-          const auto new_ttop = tau[vi] + ktilde[vi];
-          if(dt - new_ttop > num_tol)
-            {//not close to the end of the time slab
-              tent->ttop = new_ttop;
-            }
-          else
-            {//vertex is complete
-              tent->ttop = dt;
-              complete_vertices.SetBit(vi);
-            }
-          //let us ignore this for now
-          // else if(new_ttop >= dt)
-          //   {//vertex is complete
-          //     tent->ttop = dt;
-          //     complete_vertices[vi] = true;
-          //   }
-          // else
-          //   {//vertex is really close to the end of time slab.
-          //     //in this scenario, we might want to pitch a lower
-          //     //tent to avoid numerical issues with degenerate tents
-          //     tent->ttop = ktilde[vi] * 0.75 + tau[vi];
-          //   }
-          
-          tent->level = vertices_level[vi]; // 0;
-          tau[vi] = tent->ttop;
-          ktilde[vi] = 0;//assuming that ktilde[vi] was the maximum advance
 
-          //add neighboring vertices and update their level
-          for (int nb : v2v[vi])
+          pitched.Append (new PitchedTent);
+          if(pitch_tent(vi, pitched.Size()-1))
+            slabpitcher->SetVertexComplete(vi, complete_vertices);
+          slabpitcher->UpdateNeighbours(vi,adv_factor,v2v,v2e,tau,complete_vertices,
+                                        vertices_level,ktilde,ready_vertices,lh);
+        }
+
+      // ---------------------------------------------
+      // Parallel loop: constructs one tent at each vertex
+      // of a distance-2 independent set per iteration
+      // ---------------------------------------------
+      while (ready_vertices.Size() && parallel)
+        {
+          slabpitcher->GetIndependentVertices(ready_vertices, v2v,
+                                              touched_vertices, indep_vertices);
+          const int first_tent = pitched.Size();
+          for (int vi : indep_vertices)
             {
-              nb = vmap[nb]; // only update main vertex if periodic
-              tent->nbv.Append (nb);
-              tent->nbtime.Append (tau[nb]);
-              //update level of vertices if needed
-              if(vertices_level[nb] < tent->level + 1)
-                vertices_level[nb] = tent->level + 1;
-              // tent number is just array index in tents
-              if (latest_tent[nb] != -1)
-                tents[latest_tent[nb]]->dependent_tents.Append (tents.Size());
+              nlayers = max(vertices_level[vi], nlayers);
+              pitched.Append (new PitchedTent);
             }
-          latest_tent[vi] = tents.Size();
-          vertices_level[vi]++;
-
-          // Set tent internal facets
-          if(DIM==1)
-            // vertex itself represents the only internal edge/facet
-            tent->internal_facets.Append (vi);
-          else if (DIM == 2)
-            for (int e : v2e[vi]) tent->internal_facets.Append (e);
-          else
+          indep_complete.SetSize(indep_vertices.Size());
+
+          ParallelFor
+            (Range(indep_vertices), [&] (int k)
+             {
+               LocalHeap slh = lh.Split();
+               const int vi = indep_vertices[k];
+               indep_complete[k] = pitch_tent(vi, first_tent+k);
+               slabpitcher->UpdateNeighboursHeight(vi, v2v, v2e, tau, complete_vertices,
+                                                   ktilde, slh);
+             });
+
+          // update the set of ready vertices
+          for (int k : Range(indep_vertices))
             {
-              // DIM == 3 => internal facets are faces
-              //points contained in a given facet
-              ArrayMem<int,4> fpnts;
-              ArrayMem<int,30> vertex_els;
-              slabpitcher->GetVertexElements(vi,vertex_els);
-              for (auto elnr : vertex_els)
-                for (auto f : ma->GetElement(ElementId(VOL,elnr)).Faces())
-                  {
-                    //get facet vertices
-                    ma->GetFacetPNums(f, fpnts);
-                    for (auto f_v : fpnts)
-                      {
-                        if (vmap[f_v]  == vi &&
-                            !tent->internal_facets.Contains(f))
-                          {
-                            tent->internal_facets.Append(f);
-                            break;
-                          }
-                      }
-                  }
-            }          
-          slabpitcher->GetVertexElements(vi,tent->els);
-          slabpitcher->UpdateNeighbours(vi,adv_factor,v2v,v2e,tau,complete_vertices,
-                                        ktilde,vertex_ready,ready_vertices,lh);
-          tents.Append (tent);
+              const int vi = indep_vertices[k];
+              if(indep_complete[k])
+                slabpitcher->SetVertexComplete(vi, complete_vertices);
+              slabpitcher->UpdateNeighboursReadiness(vi, adv_factor, v2v, complete_vertices,
+                                                     vertices_level, ktilde, ready_vertices);
+            }
         }
       //check if slab is complete
-      slab_complete = true;
-      for(int i = 0; i < ma->GetNV(); i++)
-        if(vmap[i] == i)
-          if(complete_vertices[i] == false)
-            {
-              slab_complete = false;
-              break;
-            }
+      slab_complete = (slabpitcher->GetIncompleteVertices().Size() == 0);
     }
 
  
@@ -280,7 +456,7 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
             {
               const auto relkt = ktilde[iv] / vrefdt[iv];
               if(relkt < 1e-10) {continue;}
-              const auto ttop = tents[latest_tent[iv]]->ttop;
+              const auto ttop = pitched[latest_tent[iv]]->ttop;
               cout << "v "<<iv<<" tau "<<ttop<<" kt "<<ktilde[iv];
               cout << " rel kt = "<< relkt <<endl;
             }
@@ -289,36 +465,23 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
   delete slabpitcher;
   
 
-  // set lists of internal facets of each element of each tent
-  ParallelFor
-    (Range(tents),
-     [&] (int i)
-     {
-       Tent & tent = *tents[i];
-       TableCreator<int> elfnums_creator(tent.els.Size());
-
-       for ( ; !elfnums_creator.Done(); elfnums_creator++)  {
-	 for(int j : Range(tent.els)) {
-
-	   auto fnums = ma->GetElFacets (tent.els[j]);
-	   for(int fnum : fnums)
-	     if (tent.internal_facets.Pos(fnum) !=
-                 tent.internal_facets.ILLEGAL_POSITION)
-	       elfnums_creator.Add(j,fnum);
-	 }
-       }
-       tent.elfnums = elfnums_creator.MoveTable();
-     });
-
-  // build dependency graph (used by RunParallelDependency)
-  TableCreator<int> create_dag(tents.Size());
-  for ( ; !create_dag.Done(); create_dag++)
+  // one table per attribute, the tents become views of the tables
+  const size_t ntents = pitched.Size();
+  SetTents
+    (FlattenRows<int>(ntents, [&] (size_t i) { return FlatArray<int>(pitched[i]->nbv); }),
+     FlattenRows<double>(ntents, [&] (size_t i) { return FlatArray<double>(pitched[i]->nbtime); }),
+     FlattenRows<int>(ntents, [&] (size_t i) { return FlatArray<int>(pitched[i]->els); }),
+     FlattenRows<int>(ntents, [&] (size_t i) { return FlatArray<int>(pitched[i]->internal_facets); }),
+     FlattenRows<int>(ntents, [&] (size_t i) { return FlatArray<int>(pitched[i]->dependent_tents); }));
+  for (size_t i = 0; i < ntents; i++)
     {
-      for (int i : tents.Range())
-	for (int d : tents[i]->dependent_tents)
-	  create_dag.Add(i, d);
+      tents[i]->vertex = pitched[i]->vertex;
+      tents[i]->level = pitched[i]->level;
+      tents[i]->tbot = pitched[i]->tbot;
+      tents[i]->ttop = pitched[i]->ttop;
+      delete pitched[i];
     }
-  tent_dependency = create_dag.MoveTable();
+  BuildDependencies();
 
   // calculate slope of tents
   ParallelFor
@@ -355,12 +518,573 @@ bool TentPitchedSlab::PitchTents(const double dt, const bool calc_local_ct, cons
 	 }
      });
   has_been_pitched = slab_complete;
+  tent_ordering = ngstents::EPitchingOrder;
+  slab_version++;
   return has_been_pitched;
 }
 
-template bool TentPitchedSlab::PitchTents<1>(const double, const bool, const double);
-template bool TentPitchedSlab::PitchTents<2>(const double, const bool, const double);
-template bool TentPitchedSlab::PitchTents<3>(const double, const bool, const double);
+template bool TentPitchedSlab::PitchTents<1>(const double, const bool, const double, const bool);
+template bool TentPitchedSlab::PitchTents<2>(const double, const bool, const double, const bool);
+template bool TentPitchedSlab::PitchTents<3>(const double, const bool, const double, const bool);
+
+
+void TentPitchedSlab::BuildDependencies()
+{
+  // build dependency graph (used by RunParallelDependency)
+  TableCreator<int> create_dag(tents.Size());
+  for ( ; !create_dag.Done(); create_dag++)
+    {
+      for (int i : tents.Range())
+	for (int d : tents[i]->dependent_tents)
+	  create_dag.Add(i, d);
+    }
+  tent_dependency = create_dag.MoveTable();
+
+  // dependencies between consecutive slabs: the first tent of the next
+  // slab containing an element waits for the last tent of this slab
+  // containing it (tents sharing an element are ordered by their numbers)
+  Array<int> first_tent(ma->GetNE(VOL)), last_tent(ma->GetNE(VOL));
+  first_tent = -1;
+  last_tent = -1;
+  for (int i : tents.Range())
+    for (int el : tents[i]->els)
+      {
+        if (first_tent[el] == -1) first_tent[el] = i;
+        last_tent[el] = i;
+      }
+  TableCreator<int> create_slabdag(tents.Size());
+  for ( ; !create_slabdag.Done(); create_slabdag++)
+    for (int el : Range(first_tent))
+      if (first_tent[el] != -1)
+        create_slabdag.Add(last_tent[el], first_tent[el]);
+  slab_dependency = create_slabdag.MoveTable();
+
+  // a tent only depends on tents of lower levels
+  int maxlevel = -1;
+  for (auto tent : tents)
+    maxlevel = max(maxlevel, tent->level);
+  TableCreator<int> create_layers(maxlevel+1);
+  for ( ; !create_layers.Done(); create_layers++)
+    for (int i : tents.Range())
+      create_layers.Add(tents[i]->level, i);
+  tent_layers = create_layers.MoveTable();
+}
+
+
+void TentPitchedSlab::SetTents(Table<int> && nbv, Table<double> && nbtime,
+                               Table<int> && els, Table<int> && internal_facets,
+                               Table<int> && dependent)
+{
+  ReleaseTents();
+  const size_t ntents = nbv.Size();
+
+  // internal facets of each element of each tent, one row per element
+  Array<size_t> first_el(ntents+1);
+  first_el[0] = 0;
+  for (size_t i = 0; i < ntents; i++)
+    first_el[i+1] = first_el[i] + els[i].Size();
+  Array<int> cnt(first_el[ntents]);
+  auto ElFacets = [&] (size_t i, size_t j, auto func)
+    {
+      for (int fnum : ma->GetElFacets(els[i][j]))
+        if (internal_facets[i].Contains(fnum))
+          func(fnum);
+    };
+  ParallelFor
+    (ntents, [&] (size_t i)
+     {
+       for (size_t j = 0; j < els[i].Size(); j++)
+         {
+           cnt[first_el[i]+j] = 0;
+           ElFacets(i, j, [&] (int) { cnt[first_el[i]+j]++; });
+         }
+     });
+  Table<int> elfnums(cnt);
+  ParallelFor
+    (ntents, [&] (size_t i)
+     {
+       for (size_t j = 0; j < els[i].Size(); j++)
+         {
+           int k = 0;
+           auto row = elfnums[first_el[i]+j];
+           ElFacets(i, j, [&] (int fnum) { row[k++] = fnum; });
+         }
+     });
+
+  tent_nbv = std::move(nbv);
+  tent_nbtime = std::move(nbtime);
+  tent_els = std::move(els);
+  tent_internal_facets = std::move(internal_facets);
+  tent_dependent = std::move(dependent);
+  tent_elfnums = std::move(elfnums);
+
+  // one block of tents viewing the tables
+  if (ntents)
+    tent_block = shared_ptr<Tent>
+      (static_cast<Tent*>(::operator new (ntents * sizeof(Tent))),
+       [ntents] (Tent * p)
+       {
+         for (size_t i = 0; i < ntents; i++)
+           p[i].~Tent();
+         ::operator delete (p);
+       });
+  tents.SetSize(ntents);
+  size_t * elfnums_index = tent_elfnums.IndexArray().Data();
+  int * elfnums_data = tent_elfnums.AsArray().Data();
+  for (size_t i = 0; i < ntents; i++)
+    {
+      Tent * tent = new (tent_block.get()+i) Tent(vmap);
+      tent->nbv = tent_nbv[i];
+      tent->nbtime = tent_nbtime[i];
+      tent->els = tent_els[i];
+      tent->internal_facets = tent_internal_facets[i];
+      tent->dependent_tents = tent_dependent[i];
+      tent->elfnums = FlatTable<int>(tent->els.Size(),
+                                     elfnums_index + first_el[i], elfnums_data);
+      tents[i] = tent;
+    }
+}
+
+
+void TentPitchedSlab::ReleaseTents()
+{
+  tents.SetSize0();
+  tent_block = nullptr;
+  tent_nbv = Table<int>();
+  tent_nbtime = Table<double>();
+  tent_els = Table<int>();
+  tent_internal_facets = Table<int>();
+  tent_dependent = Table<int>();
+  tent_elfnums = Table<int>();
+}
+
+
+// Binary slab files: a header (magic, format version, byte order
+// marker, pitching method, mesh hash, slab height, maximal wavespeed)
+// and scalars, followed by raw arrays in the byte order of the writing
+// machine. Each array is preceded by its 64-bit
+// length and padded to 8 bytes, so all arrays are aligned within the
+// file.
+static constexpr char slab_magic[8] = {'N','G','S','T','E','N','T','S'};
+static constexpr uint32_t slab_format_version = 3;
+static constexpr uint32_t slab_byte_order = 0x01020304;
+
+template <typename T>
+static void WriteValue (ostream & out, const T & val)
+{
+  out.write (reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template <typename T>
+static void ReadValue (istream & in, T & val)
+{
+  in.read (reinterpret_cast<char*>(&val), sizeof(T));
+}
+
+template <typename T>
+static void WriteArray (ostream & out, FlatArray<T> a)
+{
+  WriteValue (out, uint64_t(a.Size()));
+  out.write (reinterpret_cast<const char*>(a.Data()), a.Size()*sizeof(T));
+  const char zeros[8] = { 0 };
+  out.write (zeros, (8 - (a.Size()*sizeof(T)) % 8) % 8);
+}
+
+template <typename T>
+static Array<T> ReadArray (istream & in)
+{
+  uint64_t size = 0;
+  ReadValue (in, size);
+  if (!in || size > (uint64_t(1) << 40))
+    throw Exception("corrupt tent slab file");
+  Array<T> a(size);
+  in.read (reinterpret_cast<char*>(a.Data()), size*sizeof(T));
+  in.ignore ((8 - (size*sizeof(T)) % 8) % 8);
+  return a;
+}
+
+template <typename T>
+static void WriteTable (ostream & out, FlatTable<T> table)
+{
+  WriteArray (out, table.IndexArray());
+  WriteArray (out, table.AsArray());
+}
+
+template <typename T>
+static Table<T> ReadTable (istream & in)
+{
+  auto index = ReadArray<size_t>(in);
+  if (index.Size() == 0 || index[0] != 0)
+    throw Exception("corrupt tent slab file");
+  Array<int> cnt(index.Size()-1);
+  for (size_t i = 0; i < cnt.Size(); i++)
+    {
+      if (index[i+1] < index[i])
+        throw Exception("corrupt tent slab file");
+      cnt[i] = index[i+1] - index[i];
+    }
+  // the entries are read directly into the table
+  uint64_t size = 0;
+  ReadValue (in, size);
+  if (!in || size != index.Last())
+    throw Exception("corrupt tent slab file");
+  Table<T> table(cnt);
+  in.read (reinterpret_cast<char*>(table.AsArray().Data()), size*sizeof(T));
+  in.ignore ((8 - (size*sizeof(T)) % 8) % 8);
+  return table;
+}
+
+
+uint64_t TentPitchedSlab::MeshHash() const
+{
+  // FNV-1a over the element vertices and the vertex coordinates
+  uint64_t hash = 14695981039346656037ull;
+  auto Add = [&hash] (const void * p, size_t n)
+    {
+      auto bytes = static_cast<const unsigned char*>(p);
+      for (size_t k = 0; k < n; k++)
+        hash = (hash ^ bytes[k]) * 1099511628211ull;
+    };
+  const int dim = ma->GetDimension();
+  const size_t nv = ma->GetNV(), ne = ma->GetNE(VOL);
+  Add (&dim, sizeof(dim));
+  Add (&nv, sizeof(nv));
+  Add (&ne, sizeof(ne));
+  for (auto el : ma->Elements(VOL))
+    for (int v : el.Vertices())
+      Add (&v, sizeof(v));
+  for (size_t v = 0; v < nv; v++)
+    {
+      Vec<3> p = 0.0;
+      switch (dim)
+        {
+        case 1: p(0) = ma->GetPoint<1>(v)(0); break;
+        case 2:
+          p(0) = ma->GetPoint<2>(v)(0);
+          p(1) = ma->GetPoint<2>(v)(1);
+          break;
+        default: p = ma->GetPoint<3>(v);
+        }
+      Add (&p(0), 3*sizeof(double));
+    }
+  return hash;
+}
+
+
+double TentPitchedSlab::MaxWavespeed()
+{
+  double cmax_max = 0;
+  ParallelFor
+    (ma->GetNE(VOL), [&] (size_t elnr)
+     {
+       LocalHeap slh = lh.Split();
+       const ElementId ei(VOL, elnr);
+       ElementTransformation & trafo = ma->GetTrafo (ei, slh);
+       const IntegrationRule & ir = SelectIntegrationRule (ma->GetElType(ei), 0);
+       AtomicMax (cmax_max, cmax->Evaluate (trafo(ir[0], slh)));
+     });
+  return cmax_max;
+}
+
+
+void TentPitchedSlab::Save(const string & filename) const
+{
+  if (!has_been_pitched)
+    throw Exception("Save needs a pitched tent slab");
+  ofstream out(filename, ios::binary);
+  if (!out)
+    throw Exception("cannot open " + filename + " for writing");
+
+  const size_t ntents = tents.Size();
+  Array<int> vertex(ntents), level(ntents);
+  Array<double> tbot(ntents), ttop(ntents), maxslope(ntents);
+  for (size_t i = 0; i < ntents; i++)
+    {
+      vertex[i] = tents[i]->vertex;
+      level[i] = tents[i]->level;
+      tbot[i] = tents[i]->tbot;
+      ttop[i] = tents[i]->ttop;
+      maxslope[i] = tents[i]->maxslope;
+    }
+
+  out.write (slab_magic, sizeof(slab_magic));
+  WriteValue (out, slab_format_version);
+  WriteValue (out, slab_byte_order);
+  WriteValue (out, int32_t(method));
+  WriteValue (out, MeshHash());
+  WriteValue (out, dt);
+  WriteValue (out, max_wavespeed);
+  WriteValue (out, int64_t(nlayers));
+  WriteArray (out, FlatArray<int>(vmap));
+  WriteArray (out, FlatArray<int>(vertex));
+  WriteArray (out, FlatArray<int>(level));
+  WriteArray (out, FlatArray<double>(tbot));
+  WriteArray (out, FlatArray<double>(ttop));
+  WriteArray (out, FlatArray<double>(maxslope));
+  WriteTable (out, FlatTable<int>(tent_nbv));
+  WriteTable (out, FlatTable<double>(tent_nbtime));
+  WriteTable (out, FlatTable<int>(tent_els));
+  WriteTable (out, FlatTable<int>(tent_internal_facets));
+  WriteTable (out, FlatTable<int>(tent_dependent));
+  if (!out)
+    throw Exception("error writing " + filename);
+}
+
+
+void TentPitchedSlab::Load(const string & filename, double adt)
+{
+  ifstream in(filename, ios::binary);
+  if (!in)
+    throw Exception("cannot open " + filename);
+
+  char magic[8];
+  in.read (magic, sizeof(magic));
+  if (!in || !std::equal(magic, magic+8, slab_magic))
+    throw Exception(filename + " is not a tent slab file");
+  uint32_t version = 0;
+  ReadValue (in, version);
+  if (version != slab_format_version)
+    throw Exception("unsupported tent slab file version " + ToString(version));
+  uint32_t byte_order = 0;
+  ReadValue (in, byte_order);
+  if (byte_order != slab_byte_order)
+    throw Exception(filename + " was written with a different byte order");
+  int32_t amethod = 0;
+  uint64_t hash = 0;
+  int64_t anlayers = 0;
+  double fdt = 0, fmax_wavespeed = 0;
+  ReadValue (in, amethod);
+  ReadValue (in, hash);
+  ReadValue (in, fdt);
+  ReadValue (in, fmax_wavespeed);
+  ReadValue (in, anlayers);
+  if (!in)
+    throw Exception("corrupt tent slab file " + filename);
+  if (hash != MeshHash())
+    throw Exception(filename + " was written for a different mesh");
+  if (amethod != int32_t(method))
+    throw Exception(filename + " was pitched with a different method");
+  if (adt > 0 && abs(fdt - adt) > 1e-12 * adt)
+    throw Exception(filename + " was pitched for dt = " + ToString(fdt)
+                    + " instead of " + ToString(adt));
+  // tents pitched for a smaller wavespeed would violate causality, those
+  // for a larger one are needlessly flat
+  if (cmax)
+    {
+      const double c = MaxWavespeed();
+      if (abs(fmax_wavespeed - c) > 1e-12 * max(c, fmax_wavespeed))
+        throw Exception(filename + " was pitched for the maximal wavespeed "
+                        + ToString(fmax_wavespeed) + " instead of "
+                        + ToString(c));
+    }
+
+  auto avmap = ReadArray<int>(in);
+  auto vertex = ReadArray<int>(in);
+  auto level = ReadArray<int>(in);
+  auto tbot = ReadArray<double>(in);
+  auto ttop = ReadArray<double>(in);
+  auto maxslope = ReadArray<double>(in);
+  auto nbv = ReadTable<int>(in);
+  auto nbtime = ReadTable<double>(in);
+  auto els = ReadTable<int>(in);
+  auto internal_facets = ReadTable<int>(in);
+  auto dependent = ReadTable<int>(in);
+  if (!in)
+    throw Exception("corrupt tent slab file " + filename);
+
+  const size_t ntents = vertex.Size();
+  for (size_t n : { level.Size(), tbot.Size(), ttop.Size(), maxslope.Size(),
+                    nbv.Size(), nbtime.Size(), els.Size(),
+                    internal_facets.Size(), dependent.Size() })
+    if (n != ntents)
+      throw Exception("corrupt tent slab file " + filename);
+  if (avmap.Size() != size_t(ma->GetNV()))
+    throw Exception("corrupt tent slab file " + filename);
+  // all numbers must be valid in the mesh, the hash does not protect
+  // against a damaged file
+  auto CheckRange = [&] (FlatArray<int> a, size_t n)
+    {
+      for (int k : a)
+        if (k < 0 || size_t(k) >= n)
+          throw Exception("corrupt tent slab file " + filename);
+    };
+  CheckRange (avmap, ma->GetNV());
+  CheckRange (vertex, ma->GetNV());
+  CheckRange (nbv.AsArray(), ma->GetNV());
+  CheckRange (els.AsArray(), ma->GetNE(VOL));
+  CheckRange (internal_facets.AsArray(), ma->GetNFacets());
+  CheckRange (dependent.AsArray(), ntents);
+
+  vmap = std::move(avmap);
+  dt = fdt;
+  max_wavespeed = fmax_wavespeed;
+  nlayers = anlayers;
+  SetTents(std::move(nbv), std::move(nbtime), std::move(els),
+           std::move(internal_facets), std::move(dependent));
+  for (size_t i = 0; i < ntents; i++)
+    {
+      tents[i]->vertex = vertex[i];
+      tents[i]->level = level[i];
+      tents[i]->tbot = tbot[i];
+      tents[i]->ttop = ttop[i];
+      tents[i]->maxslope = maxslope[i];
+    }
+  BuildDependencies();
+  has_been_pitched = true;
+  tent_ordering = ngstents::EPitchingOrder;
+  slab_version++;
+}
+
+
+void TentPitchedSlab::ReorderTents(ngstents::TentOrdering ordering)
+{
+  if (ordering == ngstents::EPitchingOrder || tents.Size() == 0) return;
+
+  // spatial key of each vertex, tents are sorted by (level, key)
+  const int nv = ma->GetNV();
+  Array<uint64_t> key(nv);
+  if (ordering == ngstents::EMortonOrder)
+    {
+      // interleave the bits of the vertex coordinates, scaled to the
+      // bounding box of the mesh
+      const int dim = ma->GetDimension();
+      const int bits = 63 / dim;
+      Vec<3> pmin(1e99), pmax(-1e99);
+      Array<Vec<3>> pts(nv);
+      for (int v : Range(nv))
+        {
+          pts[v] = 0.0;
+          switch (dim)
+            {
+            case 1: pts[v](0) = ma->GetPoint<1>(v)(0); break;
+            case 2:
+              pts[v](0) = ma->GetPoint<2>(v)(0);
+              pts[v](1) = ma->GetPoint<2>(v)(1);
+              break;
+            default: pts[v] = ma->GetPoint<3>(v);
+            }
+          for (int d : Range(dim))
+            {
+              pmin(d) = min(pmin(d), pts[v](d));
+              pmax(d) = max(pmax(d), pts[v](d));
+            }
+        }
+      const double scale = double((uint64_t(1) << bits) - 1);
+      for (int v : Range(nv))
+        {
+          uint64_t k = 0;
+          uint64_t c[3] = { 0, 0, 0 };
+          for (int d : Range(dim))
+            {
+              double len = pmax(d) - pmin(d);
+              double rel = (len > 0) ? (pts[v](d) - pmin(d)) / len : 0.0;
+              c[d] = uint64_t(rel * scale);
+            }
+          for (int b = bits-1; b >= 0; b--)
+            for (int d : Range(dim))
+              k = (k << 1) | ((c[d] >> b) & 1);
+          key[v] = k;
+        }
+    }
+  else
+    {
+      // reverse Cuthill-McKee numbering of the vertex graph, periodic
+      // vertices are identified with their master (which has the tent)
+      TableCreator<int> create_v2v(nv);
+      for ( ; !create_v2v.Done(); create_v2v++)
+        for (auto el : ma->Elements(VOL))
+          for (auto v1 : el.Vertices())
+            for (auto v2 : el.Vertices())
+              if (vmap[v1] != vmap[v2])
+                create_v2v.Add(vmap[v1], vmap[v2]);
+      Table<int> v2v = create_v2v.MoveTable();
+      for (int v : Range(nv))
+        QuickSort(v2v[v]);
+
+      Array<int> degree(nv), order;
+      order.SetAllocSize(nv);
+      for (int v : Range(nv))
+        degree[v] = v2v[v].Size();
+      BitArray visited(nv);
+      visited.Clear();
+      Array<int> vertices(nv), nbs;
+      for (int v : Range(nv)) vertices[v] = v;
+      QuickSortI(degree, vertices);
+      for (int start : vertices)
+        {
+          if (visited.Test(start)) continue;
+          visited.SetBit(start);
+          order.Append(start);
+          for (size_t k = order.Size()-1; k < order.Size(); k++)
+            {
+              nbs.SetSize0();
+              for (int w : v2v[order[k]])
+                if (!visited.Test(w))
+                  {
+                    visited.SetBit(w);
+                    nbs.Append(w);
+                  }
+              QuickSortI(degree, nbs);
+              for (int w : nbs)
+                order.Append(w);
+            }
+        }
+      for (int k : Range(nv))
+        key[order[k]] = nv-1-k;
+    }
+
+  // tents of lower levels first, so that the new order remains a
+  // topological order of the dependency graph
+  Array<int> perm(tents.Size());
+  for (int i : Range(perm)) perm[i] = i;
+  std::stable_sort(perm.Data(), perm.Data()+perm.Size(), [&] (int i, int j)
+    {
+      if (tents[i]->level != tents[j]->level)
+        return tents[i]->level < tents[j]->level;
+      return key[tents[i]->vertex] < key[tents[j]->vertex];
+    });
+
+  const size_t ntents = tents.Size();
+  Array<int> newnr(ntents);
+  for (int i : Range(perm))
+    newnr[perm[i]] = i;
+
+  // the tables in the new order, the scalars are kept until the old
+  // tents are released
+  auto nbv = FlattenRows<int>(ntents, [&] (size_t i) { return tents[perm[i]]->nbv; });
+  auto nbtime = FlattenRows<double>(ntents, [&] (size_t i) { return tents[perm[i]]->nbtime; });
+  auto els = FlattenRows<int>(ntents, [&] (size_t i) { return tents[perm[i]]->els; });
+  auto internal_facets = FlattenRows<int>(ntents, [&] (size_t i) { return tents[perm[i]]->internal_facets; });
+  auto dependent = FlattenRows<int>(ntents, [&] (size_t i) { return tents[perm[i]]->dependent_tents; });
+  for (int & d : dependent.AsArray())
+    d = newnr[d];
+  Array<int> vertex(ntents), level(ntents);
+  Array<double> tbot(ntents), ttop(ntents), maxslope(ntents);
+  for (size_t i = 0; i < ntents; i++)
+    {
+      const Tent & tent = *tents[perm[i]];
+      vertex[i] = tent.vertex;
+      level[i] = tent.level;
+      tbot[i] = tent.tbot;
+      ttop[i] = tent.ttop;
+      maxslope[i] = tent.maxslope;
+    }
+
+  SetTents(std::move(nbv), std::move(nbtime), std::move(els),
+           std::move(internal_facets), std::move(dependent));
+  for (size_t i = 0; i < ntents; i++)
+    {
+      tents[i]->vertex = vertex[i];
+      tents[i]->level = level[i];
+      tents[i]->tbot = tbot[i];
+      tents[i]->ttop = ttop[i];
+      tents[i]->maxslope = maxslope[i];
+    }
+  BuildDependencies();
+  tent_ordering = ordering;
+  slab_version++;
+}
+
 
 
 double TentPitchedSlab::MaxSlope() const
@@ -383,26 +1107,44 @@ TentSlabPitcher::TentSlabPitcher(shared_ptr<MeshAccess> ama, ngstents::PitchingM
 
 
 bool TentSlabPitcher::GetReadyVertices(double &adv_factor, bool reset_adv_factor,
-                                       const FlatArray<double> &ktilde, const BitArray &complete_vertices,
-                                       BitArray &vertex_ready, Array<int> &ready_vertices){
+                                       const FlatArray<double> &ktilde,
+                                       const FlatArray<int> &vertices_level,
+                                       ReadyVertexQueue &ready_vertices){
 
   bool found{false};
+  Array<int> new_ready;
+  Array<Candidate> rounded;
   //how many times the adv_factor will be relaxed looking for new vertices
   constexpr int n_attempts = 5;
-  vertex_ready = false;
   const double initial_adv_factor = adv_factor;
   for(auto ia = 0; ia < n_attempts; ia++)
     {
-      for (auto iv = 0; iv < ma->GetNV(); iv++)
-        if(vmap[iv] == iv && !complete_vertices[iv])
-          {
-            if (ktilde[iv] > adv_factor * vertex_refdt[iv])
-              if (!vertex_ready[iv])
-                {
-                  ready_vertices.Append (iv);
-                  vertex_ready.SetBit(iv);
-                }
-          }
+      //candidates by decreasing ratio ktilde/refdt, up to the first one
+      //failing the criterion. stale entries (vertices which have been
+      //completed, queued or got a new ktilde since) are dropped
+      new_ready.SetSize(0);
+      while (candidates.size() && candidates.top().ratio > adv_factor)
+        {
+          const auto cand = candidates.top();
+          candidates.pop();
+          const int iv = cand.v;
+          if (incomplete_pos[iv] == -1 || ready_vertices.Contains(iv) ||
+              ktilde[iv] != cand.ktilde)
+            continue;
+          if (ktilde[iv] > adv_factor * vertex_refdt[iv])
+            new_ready.Append(iv);
+          else // rounding of the ratio, keep it for a smaller adv_factor
+            rounded.Append(cand);
+        }
+      for (auto & cand : rounded)
+        candidates.push(cand);
+      rounded.SetSize(0);
+      //queue them by vertex number, as a scan over the vertices would
+      //do, so the tents do not depend on the order of the candidates
+      //(a vertex listed twice is only queued once)
+      QuickSort(new_ready);
+      for (int iv : new_ready)
+        ready_vertices.Insert(iv, vertices_level[iv]);
       if(ready_vertices.Size())
         {
           found = true;
@@ -417,6 +1159,28 @@ bool TentSlabPitcher::GetReadyVertices(double &adv_factor, bool reset_adv_factor
   return found;
 }
 
+void TentSlabPitcher::AddCandidate(const int v, const double ktilde_v)
+{
+  //vertices with ktilde = 0 never pass the advance criterion
+  if (ktilde_v <= 0) return;
+  const double ratio = vertex_refdt[v] > 0
+    ? ktilde_v / vertex_refdt[v] : std::numeric_limits<double>::infinity();
+  candidates.push(Candidate{ratio, ktilde_v, v});
+}
+
+void TentSlabPitcher::SetVertexComplete(const int vi, BitArray &complete_vertices)
+{
+  complete_vertices.SetBit(vi);
+  //swap vi with the last incomplete vertex
+  const int pos = incomplete_pos[vi];
+  if (pos == -1) return;
+  const int last = incomplete_vertices.Last();
+  incomplete_vertices[pos] = last;
+  incomplete_pos[last] = pos;
+  incomplete_vertices.DeleteLast();
+  incomplete_pos[vi] = -1;
+}
+
 void TentSlabPitcher::ComputeVerticesReferenceHeight(const Table<int> &v2v, const Table<int> &v2e, const FlatArray<double> &tau, LocalHeap &lh)
 {
   this->vertex_refdt = std::numeric_limits<double>::max();
@@ -424,120 +1188,180 @@ void TentSlabPitcher::ComputeVerticesReferenceHeight(const Table<int> &v2v, cons
     if(vmap[i]==i) // non-periodic
       {
         this->vertex_refdt[i] = this->GetPoleHeight(i, tau, v2v[i],v2e[i],lh);
+        AddCandidate(i, this->vertex_refdt[i]);
       }
   
 }
 
-std::tuple<int,int> TentSlabPitcher::PickNextVertexForPitching(const FlatArray<int> &ready_vertices,
-                                                               const FlatArray<double> &ktilde,
-                                                               const FlatArray<int> &vertices_level){  
-  int minlevel = std::numeric_limits<int>::max();
-  int posmin = -1;
-  for(auto i = 0; i < ready_vertices.Size(); i++)
-    if(vertices_level[ready_vertices[i]] < minlevel)
-      {
-        minlevel = vertices_level[ready_vertices[i]];
-        posmin = i;
-      }
-  return std::make_tuple(minlevel,posmin);
+std::tuple<int,int> TentSlabPitcher::PickNextVertexForPitching(ReadyVertexQueue &ready_vertices){
+  int minlevel;
+  const int vi = ready_vertices.PopMin(minlevel);
+  return std::make_tuple(minlevel,vi);
 }
 
 void TentSlabPitcher::UpdateNeighbours(const int vi, const double adv_factor, const Table<int> &v2v,
                                        const Table<int> &v2e, const FlatArray<double> &tau,
-                                       const BitArray &complete_vertices, Array<double> &ktilde,
-                                       BitArray &vertex_ready, Array<int> &ready_vertices,
-                                       LocalHeap &lh){
+                                       const BitArray &complete_vertices,
+                                       const FlatArray<int> &vertices_level, Array<double> &ktilde,
+                                       ReadyVertexQueue &ready_vertices, LocalHeap &lh){
+  UpdateNeighboursHeight(vi, v2v, v2e, tau, complete_vertices, ktilde, lh);
+  UpdateNeighboursReadiness(vi, adv_factor, v2v, complete_vertices, vertices_level,
+                            ktilde, ready_vertices);
+}
+
+void TentSlabPitcher::UpdateNeighboursReadiness(const int vi, const double adv_factor,
+                                                const Table<int> &v2v,
+                                                const BitArray &complete_vertices,
+                                                const FlatArray<int> &vertices_level,
+                                                const FlatArray<double> &ktilde,
+                                                ReadyVertexQueue &ready_vertices)
+{
   for (int nb : v2v[vi])
     {
       nb = vmap[nb]; // map periodic vertices
       if (complete_vertices[nb]) continue;
-      const double kt = GetPoleHeight(nb, tau, v2v[nb], v2e[nb],lh);
-      ktilde[nb] = kt;
-      if (kt > adv_factor * vertex_refdt[nb])
-        {
-          if (!vertex_ready[nb])
-            {
-              ready_vertices.Append (nb);
-              vertex_ready.SetBit(nb);
-            }
-        }
+      // the level of nb may have changed as well, so (re-)insert it
+      if (ktilde[nb] > adv_factor * vertex_refdt[nb])
+        ready_vertices.Insert(nb, vertices_level[nb]);
       else
         {
-          vertex_ready.Clear(nb);
-          const auto pos_nb = ready_vertices.Pos(nb);
-          if(pos_nb != ready_vertices.ILLEGAL_POSITION)
-            {
-              ready_vertices.RemoveElement(pos_nb);
-            }
+          ready_vertices.Remove(nb);
+          AddCandidate(nb, ktilde[nb]);
         }
-    } 
+    }
+}
+
+void TentSlabPitcher::UpdateNeighboursHeight(const int vi, const Table<int> &v2v,
+                                             const Table<int> &v2e, const FlatArray<double> &tau,
+                                             const BitArray &complete_vertices,
+                                             FlatArray<double> ktilde, LocalHeap &lh) const
+{
+  for (int nb : v2v[vi])
+    {
+      nb = vmap[nb]; // map periodic vertices
+      if (complete_vertices[nb]) continue;
+      ktilde[nb] = GetPoleHeight(nb, tau, v2v[nb], v2e[nb],lh);
+    }
+}
+
+void TentSlabPitcher::GetIndependentVertices(ReadyVertexQueue &ready_vertices,
+                                             const Table<int> &v2v, BitArray &touched,
+                                             Array<int> &indep_vertices) const
+{
+  indep_vertices.SetSize(0);
+  //two vertices are at distance <= 2 iff their closed neighbourhoods
+  //intersect. touched holds the closed neighbourhoods of the selected vertices
+  ready_vertices.IterateByLevel
+    ([&] (int vi, int level)
+     {
+       bool independent = !touched[vi];
+       for (int nb : v2v[vi])
+         if (touched[vmap[nb]]) { independent = false; break; }
+       if (!independent) return;
+       indep_vertices.Append(vi);
+       touched.SetBit(vi);
+       for (int nb : v2v[vi])
+         touched.SetBit(vmap[nb]);
+     });
+  //reset touched only where it was set
+  for (int vi : indep_vertices)
+    {
+      ready_vertices.Remove(vi);
+      touched.Clear(vi);
+      for (int nb : v2v[vi])
+        touched.Clear(vmap[nb]);
+    }
 }
 
 template<int DIM>
 std::tuple<Table<int>,Table<int>> TentSlabPitcher::InitializeMeshData(LocalHeap &lh, shared_ptr<CoefficientFunction>wavespeed, bool calc_local_ct, const double global_ct)
 {
   constexpr auto el_type = EL_TYPE(DIM);//simplex of dimension dim
-  constexpr auto n_el_vertices = DIM + 1;//number of vertices of that simplex
   //sets global constant
   this->global_ctau = global_ct;
   BitArray fine_edges(ma->GetNEdges());
   fine_edges.Clear();
 
-  //minimum length of the adjacent edges for each element's vertices
-  ArrayMem<double, n_el_vertices> max_edge(n_el_vertices);
-  ArrayMem<int,n_el_vertices> v_indices(n_el_vertices);
   //the mesh contains only simplices so only one integration rule is needed
   IntegrationRule ir(el_type, 0);
-  for (Ngs_Element el : this->ma->Elements(VOL))
-    {
-      HeapReset hr(lh);
-      max_edge = -1;
-      auto ei = ElementId(el);
-      ElementTransformation & trafo = this->ma->GetTrafo (ei, lh);
-      MappedIntegrationPoint<DIM,DIM> mip(ir[0],trafo);
-      const auto wvspd = wavespeed->Evaluate(mip);
-      if(method == ngstents::PitchingMethod::EVolGrad)
-        {this->cmax[el.Nr()] = wvspd;}
-
-
-      v_indices = ma->GetElVertices(ei);
-      //set all edges belonging to the mesh
-      for (int e : el.Edges())
-        {
-          auto pnts = ma->GetEdgePNums(e);
-          auto v1 = pnts[0], v2 = pnts[1];
-          if(!fine_edges[e])
-            {
-              fine_edges.SetBit(e);
-              double len = L2Norm (ma-> template GetPoint<DIM>(v1)
-                               - ma-> template GetPoint<DIM>(v2));
-              edge_len[e] = len;
-            }
-          if(method == ngstents::PitchingMethod::EEdgeGrad)
-            {
-              this->cmax[e] = max(this->cmax[e],wvspd);
-            }
-        }
-    }
+  SIMD_IntegrationRule simd_ir(el_type, 0);
+  //the wavespeed goes through the SIMD evaluation of the coefficient
+  //function, which compiled coefficient functions provide. a function
+  //without SIMD support switches all further elements to the scalar path
+  std::atomic<bool> use_simd(true);
+  ParallelFor
+    (ma->GetNE(VOL), [&] (size_t elnr)
+     {
+       LocalHeap slh = lh.Split();
+       const ElementId ei(VOL, elnr);
+       ElementTransformation & trafo = this->ma->GetTrafo (ei, slh);
+       double wvspd = 0;
+       if (use_simd)
+         try
+           {
+             auto & simd_mir = trafo(simd_ir, slh);
+             FlatMatrix<SIMD<double>> values(1, simd_ir.Size(), slh);
+             wavespeed->Evaluate(simd_mir, values);
+             wvspd = values(0,0)[0];
+           }
+         catch (const ExceptionNOSIMD &)
+           {
+             use_simd = false;
+           }
+       if (!use_simd)
+         {
+           MappedIntegrationPoint<DIM,DIM> mip(ir[0],trafo);
+           wvspd = wavespeed->Evaluate(mip);
+         }
+       if(method == ngstents::PitchingMethod::EVolGrad)
+         {this->cmax[elnr] = wvspd;}
+
+       //set all edges belonging to the mesh
+       for (int e : ma->GetElEdges(ei))
+         {
+           fine_edges.SetBitAtomic(e);
+           if(method == ngstents::PitchingMethod::EEdgeGrad)
+             AtomicMax(this->cmax[e], wvspd);
+         }
+     });
+  ParallelFor
+    (ma->GetNEdges(), [&] (size_t e)
+     {
+       if (!fine_edges.Test(e)) return;
+       auto pnts = ma->GetEdgePNums(e);
+       edge_len[e] = L2Norm (ma-> template GetPoint<DIM>(pnts[0])
+                             - ma-> template GetPoint<DIM>(pnts[1]));
+     });
   //map periodic vertices
   MapPeriodicVertices();
   RemovePeriodicEdges(fine_edges);
+  //initially all main vertices are incomplete
+  incomplete_vertices.SetSize(0);
+  incomplete_pos.SetSize(ma->GetNV());
+  incomplete_pos = -1;
+  for (int i : Range(ma->GetNV()))
+    if (vmap[i] == i)
+      {
+        incomplete_pos[i] = incomplete_vertices.Size();
+        incomplete_vertices.Append(i);
+      }
   //compute neighbouring data
   TableCreator<int> create_v2e, create_v2v;
   for ( ; !create_v2e.Done(); create_v2e++, create_v2v++)
-    {
-      for (int e : IntRange (0, ma->GetNEdges()))
-        if(fine_edges.Test(e))
-          {
-            auto vts = ma->GetEdgePNums (e);
-            int v1 = vts[0], v2 = vts[1];
-            //if v1 (or v2) is not periodic, vmap[v1] == v1
-            create_v2v.Add (vmap[v1], v2);
-            create_v2e.Add (vmap[v1], e);
-            create_v2v.Add (vmap[v2], v1);
-            create_v2e.Add (vmap[v2], e);
-          }
-    }
+    ParallelFor
+      (ma->GetNEdges(), [&] (size_t e)
+       {
+         if(fine_edges.Test(e))
+           {
+             auto vts = ma->GetEdgePNums (e);
+             int v1 = vts[0], v2 = vts[1];
+             //if v1 (or v2) is not periodic, vmap[v1] == v1
+             create_v2v.Add (vmap[v1], v2);
+             create_v2e.Add (vmap[v1], e);
+             create_v2v.Add (vmap[v2], v1);
+             create_v2e.Add (vmap[v2], e);
+           }
+       });
 
   TableCreator<int> create_per_verts(ma->GetNV());
   for ( ; !create_per_verts.Done(); create_per_verts++)
@@ -549,6 +1373,20 @@ std::tuple<Table<int>,Table<int>> TentSlabPitcher::InitializeMeshData(LocalHeap
 
   auto v2v = create_v2v.MoveTable();
   auto v2e = create_v2e.MoveTable();
+  // restore the order of the serial construction (by edge number),
+  // pitching depends on the order of the neighbours
+  ParallelFor
+    (v2e.Size(), [&] (size_t v)
+     {
+       auto edges = v2e[v];
+       auto nbs = v2v[v];
+       for (size_t i = 1; i < edges.Size(); i++)
+         for (size_t j = i; j > 0 && edges[j-1] > edges[j]; j--)
+           {
+             Swap (edges[j-1], edges[j]);
+             Swap (nbs[j-1], nbs[j]);
+           }
+     });
   per_verts = create_per_verts.MoveTable();
   if(calc_local_ct && DIM > 1)
     {
@@ -717,37 +1555,33 @@ template <int DIM> double VolumeGradientPitcher<DIM>::GetPoleHeight(const int vi
  }
 
 template <int DIM>
-Table<double> VolumeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &lh, const Table<int> &v2e){
-  constexpr auto el_type = EL_TYPE(DIM);//simplex of dimension dim
-  constexpr auto n_el_vertices = DIM + 1;//number of vertices of that simplex
-  
+Table<double> VolumeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &, const Table<int> &v2e){
   const auto n_mesh_vertices = ma->GetNV();
-  //this table will contain the local mesh-dependent constant
-  TableCreator<double> create_local_ctau;
-  create_local_ctau.SetSize(n_mesh_vertices);
-  create_local_ctau.SetMode(2);
-  ArrayMem<int,30>vertex_els(0);
-  //just calculating the size of the table
-  for(auto vi : IntRange(0, n_mesh_vertices))
-    {
-      if(vi != vmap[vi]) {continue;}
-      this->GetVertexElements(vi,vertex_els);
-      const auto n_vert_els = vertex_els.Size();
-      for(auto el : IntRange(0, n_vert_els))
-        {create_local_ctau.Add(vi,0);}
-    }
-  create_local_ctau++;// it is in insert mode
+  //this table will contain the local mesh-dependent constant,
+  //one entry per element around each (main) vertex
+  Array<int> cnt(n_mesh_vertices);
+  ParallelFor
+    (n_mesh_vertices, [&] (size_t vi)
+     {
+       ArrayMem<int,30> vertex_els(0);
+       cnt[vi] = 0;
+       if(vi != vmap[vi]) {return;}
+       this->GetVertexElements(vi,vertex_els);
+       cnt[vi] = vertex_els.Size();
+     });
+  Table<double> local_ctau(cnt);
   //for a given vertex V in an element E with faces F the constant is calculated as
   //the minimum (over the faces F) ratio between the length of the opposite
   //edge and the biggest edge adjacent to V in F
   //therefore it must be ensured that ctau <=1
-  for(auto vi : IntRange(0,n_mesh_vertices))
-    {
-      if(vi != vmap[vi]){continue;}
+  ParallelFor
+    (n_mesh_vertices, [&] (size_t vi)
+     {
+      if(vi != vmap[vi]){return;}
+      ArrayMem<int,30> vertex_els(0);
       this->GetVertexElements(vi,vertex_els);
       for(auto iel : IntRange(0,vertex_els.Size()))
         {
-          HeapReset hr(lh);
           const auto el_num = vertex_els[iel];
           const ElementId ei(VOL,el_num);
           auto faces = ma->GetElFaces(ei);
@@ -785,12 +1619,11 @@ Table<double> VolumeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &lh, const Tab
               val = min(val,opposite_edge/max_edge);
             }
           //val must be <=1
-          val = min(val,1.0);
-          create_local_ctau.Add(vi,val);
+          local_ctau[vi][iel] = min(val,1.0);
         }
-    }
+     });
 
-  return create_local_ctau.MoveTable();
+  return local_ctau;
 }
 
 template <int DIM>
@@ -818,24 +1651,15 @@ Table<double> EdgeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &lh, const Table
   constexpr auto el_type = EL_TYPE(DIM);//simplex of dimension dim
   constexpr auto n_el_vertices = DIM + 1;//number of vertices of that simplex
   const auto n_mesh_vertices = ma->GetNV();
-  //this table will contain the local mesh-dependent constant
-  TableCreator<double> create_local_ctau;
-  create_local_ctau.SetSize(n_mesh_vertices);
-  create_local_ctau.SetMode(2);
-  //just calculating the size of the table
+  //this table will contain the local mesh-dependent constant,
+  //one entry per edge around each (main) vertex
+  Array<int> cnt(n_mesh_vertices);
   for(auto vi : IntRange(0, n_mesh_vertices))
-    {
-      if(vi != vmap[vi]) {continue;}
-      const auto n_edges_vert = v2e[vi].Size();
-      for(auto el : IntRange(0, n_edges_vert))
-        {create_local_ctau.Add(vi,0);}
-    }
-  create_local_ctau++;// it is in insert mode
+    cnt[vi] = (vi == vmap[vi] && vi < v2e.Size()) ? v2e[vi].Size() : 0;
+  Table<double> local_ctau(cnt);
   
   //used to calculate distance to opposite facet
   ScalarFE<el_type,1> my_fel;
-  ArrayMem<int, 30> edge_els(0);
-  ArrayMem<int, 30> edge_faces(0);
   //the mesh contains only simplices so only one integration rule is needed
   IntegrationRule ir(el_type, 0);
 
@@ -846,11 +1670,16 @@ Table<double> EdgeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &lh, const Table
   //this constant was developed with the 2D scenario in mind.
   //in 3D, it is thus necessary to scale this projection w.r.t. the
   //projection of the gradient over the respective face
-  for(auto vi : IntRange(0, n_mesh_vertices))
+  ParallelFor
+    (n_mesh_vertices, [&] (size_t vi)
     {
-      if(vi != vmap[vi]){continue;}
-      for(auto edge : v2e[vi])
+      if(vi != vmap[vi] || vi >= v2e.Size()){return;}
+      LocalHeap slh = lh.Split();
+      ArrayMem<int, 30> edge_els(0);
+      ArrayMem<int, 30> edge_faces(0);
+      for(auto iedge : Range(v2e[vi]))
         {
+          const int edge = v2e[vi][iedge];
           //gets the elements that have this edge as a side
           edge_els.SetSize(0);
           
@@ -862,13 +1691,13 @@ Table<double> EdgeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &lh, const Table
           //iterate through the elements containing the edge
           for (auto  iel : edge_els)
             {
-              HeapReset hr(lh);
+              HeapReset hr(slh);
               //gradient of basis functions on the current element  
-              FlatMatrixFixWidth<DIM,double> gradphi(n_el_vertices,lh);
+              FlatMatrixFixWidth<DIM,double> gradphi(n_el_vertices,slh);
               const auto ei = ElementId(iel);
               const auto el = ma->GetElement(ei);             
 
-              ElementTransformation &trafo = this->ma->GetTrafo(ei, lh);
+              ElementTransformation &trafo = this->ma->GetTrafo(ei, slh);
               MappedIntegrationPoint<DIM,DIM> mip(ir[0],trafo);
               my_fel.CalcMappedDShape(mip,gradphi);
               //let us test for periodicity support
@@ -970,10 +1799,10 @@ Table<double> EdgeGradientPitcher<DIM>::CalcLocalCTau(LocalHeap &lh, const Table
               const auto projGrad = one_over_max_grad /edge_len[edge];
               val = min(val,projGrad);
             }
-          create_local_ctau.Add(vi,val);
+          local_ctau[vi][iedge] = val;
         }
-    }
-  return create_local_ctau.MoveTable();
+    });
+  return local_ctau;
   
 }
 
@@ -1106,20 +1935,377 @@ ostream & operator<< (ostream & ost, const Tent & tent)
     ost << k << ": " << tent.nbv[k] << " " << tent.nbtime[k] << endl;
   ost << "elements: " << endl << tent.els << endl;
   ost << "internal_facets: " << endl << tent.internal_facets << endl;
-  ost << "elfnums: " << endl << tent.elfnums << endl;
+  ost << "elfnums: " << endl;
+  for (size_t k = 0; k < tent.elfnums.Size(); k++)
+    ost << k << ": " << tent.elfnums[k] << endl;
   return ost;
 }
 
 
+///////////// MeshGeometryData /////////////////////////////////////////////
+
+
+template <typename TFUNC>
+void MeshGeometryData::BuildInBlocks(size_t n, size_t bytes_per_item,
+                                     TFUNC func)
+{
+  if (n == 0) return;
+  const size_t nblocks = min(n, size_t(4*TaskManager::GetMaxThreads()));
+  const size_t offset = heaps.Size();
+  heaps.SetSize(offset + nblocks);
+  heapused.SetSize(offset + nblocks);
+  ParallelFor
+    (nblocks, [&] (size_t b)
+     {
+       auto r = Range(n).Split(b, nblocks);
+       size_t heapsize = bytes_per_item * r.Size() + 10000;
+       while (true)
+         {
+           auto heap = make_unique<LocalHeap>(heapsize, "MeshGeometryData");
+           try
+             {
+               for (auto i : r)
+                 func(i, *heap);
+               heapused[offset+b] = heapsize - heap->Available();
+               heaps[offset+b] = std::move(heap);
+               return;
+             }
+           catch (const LocalHeapOverflow &)
+             {
+               // start the block again with a larger heap
+               heapsize *= 2;
+             }
+         }
+     });
+}
+
+MeshGeometryData::MeshGeometryData(shared_ptr<FESpace> afes,
+                                   bool aprivate_trafos, bool amapped_points)
+  : fes(afes), ma(afes->GetMeshAccess()), private_trafos(aprivate_trafos),
+    mapped_points(amapped_points ||
+                  !dynamic_pointer_cast<L2HighOrderFESpace>(afes))
+{
+  const int dim = ma->GetDimension();
+  const int order = fes->GetOrder();
+  const size_t ne = ma->GetNE(VOL);
+  const size_t nf = ma->GetNFacets();
+
+  fe.SetSize(ne);
+  ir.SetSize(ne);
+  mir.SetSize(ne);
+  trafo.SetSize(ne);
+  mesh_size.SetSize(ne);
+  affine.SetSize(ne);
+  jacinv.SetSize(ne*dim*dim);
+  jacdet.SetSize(ne);
+  invdiag.SetSize(ne);
+  invmass.SetSize(ne);
+  ipweight.SetSize(ne);
+  curvedinv.SetSize(ne);
+  BuildInBlocks
+    (ne, 5000, [&] (size_t i, LocalHeap & glh)
+     {
+       ElementId ei(VOL, i);
+       fe[i] = &fes->GetFE (ei, glh);
+       auto et = fe[i]->ElementType();
+       ir[i] = new (glh) SIMD_IntegrationRule(et,2*order);
+       trafo[i] = &ma->GetTrafo (ei, glh);
+       affine[i] = !ma->GetElement(ei).is_curved &&
+         (et == ET_SEGM || et == ET_TRIG || et == ET_TET);
+       if (affine[i])
+         {
+           // the Jacobian is constant, the mapped rule is only stored
+           // if the equation needs the points
+           if (mapped_points)
+             mir[i] = &(*trafo[i]) (*ir[i], glh);
+           HeapReset hr(glh);
+           FlatMatrix<> jac(dim, dim, glh);
+           trafo[i]->CalcJacobian(IntegrationPoint(0.0), jac);
+           double det;
+           switch (dim)
+             {
+             case 1: det = jac(0,0); break;
+             case 2: det = jac(0,0)*jac(1,1) - jac(0,1)*jac(1,0); break;
+             default:
+               det = jac(0,0)*(jac(1,1)*jac(2,2) - jac(1,2)*jac(2,1))
+                 - jac(0,1)*(jac(1,0)*jac(2,2) - jac(1,2)*jac(2,0))
+                 + jac(0,2)*(jac(1,0)*jac(2,1) - jac(1,1)*jac(2,0));
+             }
+           auto jinv = JacobianInverse(i);
+           jinv = jac;
+           CalcInverse(jinv);
+           jacdet[i] = fabs(det);
+           if (!mapped_points)
+             mir[i] = nullptr;
+           mesh_size[i] = pow(jacdet[i], 1.0/dim);
+         }
+       else
+         {
+           jacdet[i] = 0.0;
+           mir[i] = &(*trafo[i]) (*ir[i], glh);
+           mesh_size[i] = pow(fabs((*mir[i])[0].GetJacobiDet()[0]),
+                              1.0/mir[i]->DimElement());
+         }
+
+       // data of the inverse mass matrix
+       auto & fel = static_cast<const BaseScalarFiniteElement&> (*fe[i]);
+       const size_t ndof = fel.GetNDof();
+       const size_t nip = ir[i]->Size();
+       invdiag[i].AssignMemory(ndof, glh);
+       fel.GetDiagMassMatrix(invdiag[i]);
+       for (size_t j = 0; j < ndof; j++)
+         invdiag[i](j) = 1.0 / invdiag[i](j);
+       ipweight[i].AssignMemory(nip, glh);
+       for (size_t k = 0; k < nip; k++)
+         ipweight[i](k) = (*ir[i])[k].Weight() /
+           (affine[i] ? SIMD<double>(jacdet[i]) : (*mir[i])[k].GetMeasure());
+
+       if (ma->GetElement(ei).is_curved)
+         {
+           // the inverse mass matrix is approximated by
+           // D^-1 (phi_i, phi_j / |det J|) D^-1, D the reference diagonal,
+           // as SolveM did on the fly before. A Cholesky factor of the
+           // exact mass matrix would change the scheme and still cost two
+           // triangular solves, the dense product is one gemm per call.
+           invmass[i].AssignMemory(0, nullptr);
+           curvedinv[i].AssignMemory(ndof, ndof, glh);
+           HeapReset hr(glh);
+           FlatVector<> col(ndof, glh);
+           FlatVector<SIMD<double>> pntvals(nip, glh);
+           for (size_t j = 0; j < ndof; j++)
+             {
+               col = 0.0;
+               col(j) = invdiag[i](j);
+               fel.Evaluate(*ir[i], col, pntvals);
+               for (size_t k = 0; k < nip; k++)
+                 pntvals(k) *= ipweight[i](k);
+               col = 0.0;
+               fel.AddTrans(*ir[i], pntvals, col);
+               for (size_t l = 0; l < ndof; l++)
+                 curvedinv[i](l,j) = invdiag[i](l) * col(l);
+             }
+         }
+       else
+         {
+           // constant measure, the mass matrix is a scaled diagonal
+           double measure = affine[i] ? jacdet[i] : (*mir[i])[0].GetMeasure()[0];
+           invmass[i].AssignMemory(ndof, glh);
+           for (size_t j = 0; j < ndof; j++)
+             invmass[i](j) = invdiag[i](j) / measure;
+           curvedinv[i].AssignMemory(0, 0, nullptr);
+         }
+     });
+
+  if (!mapped_points)
+    {
+      // the affine elements are the simplices of the mesh dimension, they
+      // share the rule mapped by the first of them
+      auto first = affine.Pos(true);
+      if (first != affine.ILLEGAL_POSITION)
+        BuildInBlocks
+          (1, 5000, [&] (size_t, LocalHeap & glh)
+           {
+             auto rep = &(*trafo[first]) (*ir[first], glh);
+             for (size_t i = 0; i < ne; i++)
+               if (affine[i])
+                 mir[i] = rep;
+           });
+    }
+
+  facet_els.SetSize(nf);
+  facet_locnr.SetSize(nf);
+  fir.SetSize(nf);
+  firi.SetSize(nf);
+  mfiri1.SetSize(nf);
+  mfiri2.SetSize(nf);
+  normals.SetSize(nf);
+  BuildInBlocks
+    (nf, 3000, [&] (size_t f, LocalHeap & glh)
+     {
+       ngcore::IVec<2> loc_facetnr;
+
+       ArrayMem<int,2> elnums;
+       ArrayMem<int,2> elnums_per;
+       ma->GetFacetElements(f, elnums);
+
+       bool periodic_facet = false;
+       int facet2;
+       if(elnums.Size() < 2)
+         {
+           facet2 = ma->GetPeriodicFacet(f);
+           if(facet2 != int(f))
+             {
+               ma->GetFacetElements (facet2, elnums_per);
+               if (elnums_per.Size())
+                 {
+                   periodic_facet = true;
+                   elnums.Append(elnums_per[0]);
+                 }
+             }
+         }
+
+       facet_els[f] = ngcore::IVec<2>(-1);
+       facet_locnr[f] = ngcore::IVec<2>(-1);
+       fir[f] = nullptr;
+       firi[f] = Vec<2,const SIMD_IntegrationRule*>(nullptr);
+       mfiri1[f] = mfiri2[f] = nullptr;
+       for(int j : Range(elnums.Size()))
+         {
+           facet_els[f][j] = elnums[j];
+           auto fnums = ma->GetElFacets (elnums[j]);
+           int fnr = f;
+           if(periodic_facet)
+             {
+               auto pos = fnums.Pos(facet2);
+               if(pos != size_t(-1))
+                 fnr = facet2; // change facet nr to periodic
+             }
+           for (int k : Range(fnums.Size()))
+             if (fnums[k] == fnr) loc_facetnr[j] = k;
+           facet_locnr[f][j] = loc_facetnr[j];
+
+           auto & eltrafo = *trafo[elnums[j]];
+
+           auto vnums = ma->GetElVertices (elnums[j]);
+           Facet2ElementTrafo transform(eltrafo.GetElementType(), vnums);
+
+           auto etfacet = ElementTopology::
+             GetFacetType (eltrafo.GetElementType(), loc_facetnr[j]);
+
+           if(j == 0)
+             {
+               fir[f] = new (glh) SIMD_IntegrationRule (etfacet, 2*order+1);
+               fir[f]->SetIRX(nullptr); // quick fix to avoid usage of TP elements (slows down)
+             }
+
+           firi[f][j] = &transform(loc_facetnr[j], *fir[f], glh);
+           if(j == 0)
+             {
+               mfiri1[f] = &eltrafo(*firi[f][j], glh);
+               mfiri1[f]->ComputeNormalsAndMeasure(eltrafo.GetElementType(),
+                                                   loc_facetnr[j]);
+               normals[f].AssignMemory(dim, firi[f][j]->Size(), glh);
+               normals[f] = Trans(mfiri1[f]->GetNormals());
+             }
+           else
+             mfiri2[f] = &eltrafo(*firi[f][j], glh);
+         }
+     });
+
+  eltable.SetSize(ne);
+  eltable = -1;
+  facettable.SetSize(nf);
+  facettable = ngcore::IVec<2>(-1);
+  if (!dynamic_pointer_cast<L2HighOrderFESpace>(fes))
+    return;
+
+  // one table per element type, number of dofs and ordering of the
+  // vertices (given by their ranks)
+  Array<uint64_t> keys;
+  for (size_t i = 0; i < ne; i++)
+    {
+      auto vnums = ma->GetElVertices(ElementId(VOL, i));
+      uint64_t ranks = 0;
+      for (size_t k = 0; k < vnums.Size(); k++)
+        {
+          int rank = 0;
+          for (size_t j = 0; j < vnums.Size(); j++)
+            if (vnums[j] < vnums[k]) rank++;
+          ranks = 8*ranks + rank;
+        }
+      uint64_t key = (ranks << 32) | (uint64_t(fe[i]->GetNDof()) << 8)
+        | uint64_t(fe[i]->ElementType());
+      auto pos = keys.Pos(key);
+      if (pos == keys.ILLEGAL_POSITION)
+        {
+          pos = keys.Size();
+          keys.Append(key);
+          tables.Append(make_unique<BasisTable>(*fe[i], *ir[i], true));
+        }
+      eltable[i] = pos;
+    }
+
+  // the facet IP's in local coordinates of an element are fixed by its
+  // class and the local facet number
+  Array<uint64_t> fkeys;
+  Array<int> ftables;
+  for (size_t f = 0; f < nf; f++)
+    for (int j : Range(2))
+      {
+        const int elnr = facet_els[f][j];
+        if (elnr == -1) continue;
+        uint64_t key = 64*uint64_t(eltable[elnr]) + facet_locnr[f][j];
+        auto pos = fkeys.Pos(key);
+        if (pos == fkeys.ILLEGAL_POSITION)
+          {
+            pos = fkeys.Size();
+            fkeys.Append(key);
+            ftables.Append(tables.Size());
+            tables.Append(make_unique<BasisTable>(*fe[elnr], *firi[f][j],
+                                                  false));
+          }
+        facettable[f][j] = ftables[pos];
+      }
+}
+
+size_t MeshGeometryData::GetMemoryUsage() const
+{
+  size_t used = 0;
+  for (auto u : heapused)
+    used += u;
+  for (auto & tab : tables)
+    used += sizeof(double) * (tab->shape.Height()*tab->shape.Width()
+                              + tab->dshape.Height()*tab->dshape.Width());
+  return used;
+}
+
+
+///////////// BasisTable ///////////////////////////////////////////////////
+
+BasisTable::BasisTable(const FiniteElement & fe, const SIMD_IntegrationRule & ir,
+                       bool gradients)
+{
+  auto & fel = static_cast<const BaseScalarFiniteElement&> (fe);
+  const int dim = fel.Dim();
+  const size_t ndof = fel.GetNDof();
+  const size_t nlanes = SIMD<double>::Size();
+  const size_t nip = ir.Size() * nlanes;
+
+  shape.SetSize(ndof, nip);
+  if (gradients)
+    dshape.SetSize(ndof, dim*nip);
+
+  Vector<> shapek(ndof);
+  Matrix<> dshapek(ndof, dim);
+  for (size_t i = 0; i < ir.Size(); i++)
+    for (size_t lane = 0; lane < nlanes; lane++)
+      {
+        const size_t k = i*nlanes + lane;
+        IntegrationPoint ip(ir[i](0)[lane], ir[i](1)[lane], ir[i](2)[lane]);
+        fel.CalcShape(ip, shapek);
+        shape.Col(k) = shapek;
+        if (gradients)
+          {
+            fel.CalcDShape(ip, dshapek);
+            for (int r = 0; r < dim; r++)
+              dshape.Col(r*nip + k) = dshapek.Col(r);
+          }
+      }
+}
+
+
 ///////////// TentDataFE ///////////////////////////////////////////////////
 
 
-TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
+TentDataFE::TentDataFE(const Tent & tent, const MeshGeometryData & geom,
+                       LocalHeap & lh)
   : fei(tent.els.Size(), lh),
     iri(tent.els.Size(), lh),
     miri(tent.els.Size(), lh),
     trafoi(tent.els.Size(), lh),
     mesh_size(tent.els.Size(), lh),
+    jacdet(tent.els.Size(), lh),
+    jacinv(tent.els.Size(), lh),
     agradphi_bot(tent.els.Size(), lh),
     agradphi_top(tent.els.Size(), lh),
     adelta(tent.els.Size(), lh),
@@ -1133,13 +2319,23 @@ TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
     agradphi_botf2(tent.internal_facets.Size(), lh),
     agradphi_topf2(tent.internal_facets.Size(), lh),
     anormals(tent.internal_facets.Size(), lh),
-    adelta_facet(tent.internal_facets.Size(), lh)
+    adelta_facet(tent.internal_facets.Size(), lh),
+    tabi(tent.els.Size(), lh),
+    ftabi(tent.internal_facets.Size(), lh)
 {
-  auto & ma = fes.GetMeshAccess();
+  auto & ma = geom.ma;
+  auto & fes = *geom.fes;
   int dim = ma->GetDimension();
-  int order = fes.GetOrder();
 
   size_t ntents = tent.els.Size();
+
+  // the dof arrays live in lh as well, the setup does not allocate
+  size_t ndofs = 0;
+  for (int elnr : tent.els)
+    ndofs += geom.fe[elnr]->GetNDof();
+  dofs.Assign(ndofs, lh);
+  ranges.Assign(ntents, lh);
+
   FlatArray<BaseScalarFiniteElement*> fe_nodal(ntents, lh);
   FlatArray<FlatVector<double>> coef_delta(ntents, lh);
   FlatArray<FlatVector<double>> coef_top(ntents, lh);
@@ -1148,23 +2344,38 @@ TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
   // precompute element data for given tent
   for (size_t i = 0; i < ntents; i++)
     {
-      ElementId ei(VOL, tent.els[i]);
-      Array<int> dnums;
+      const int elnr = tent.els[i];
+      ElementId ei(VOL, elnr);
+      const size_t first = (i == 0) ? 0 : ranges[i-1].Next();
+      ranges[i] = IntRange(first, first + geom.fe[elnr]->GetNDof());
+      Array<int> dnums(ranges[i].Size(), dofs.Data() + first);
       fes.GetDofNrs (ei, dnums);
-      ranges.Append(IntRange(dnums.Size()) + dofs.Size());
-      dofs += dnums;
-
-      fei[i] = &fes.GetFE (ei, lh);
-      iri[i] = new (lh) SIMD_IntegrationRule(fei[i]->ElementType(),2*order);
-      trafoi[i] = &ma->GetTrafo (ei, lh);
-      miri[i] =  &(*trafoi[i]) (*iri[i], lh);
-
-      mesh_size[i] = pow(fabs((*miri[i])[0].GetJacobiDet()[0]),
-                         1.0/miri[i]->DimElement());
-
-      auto nipt = miri[i]->Size();
-      agradphi_bot[i].AssignMemory(dim, nipt, lh);
-      agradphi_top[i].AssignMemory(dim, nipt, lh);
+      if (geom.dofmap.Size())
+        for (auto & d : dnums)
+          d = geom.dofmap[d];
+
+      fei[i] = geom.fe[elnr];
+      iri[i] = geom.ir[elnr];
+      trafoi[i] = geom.trafo[elnr];
+      miri[i] = geom.mir[elnr];
+      if (geom.private_trafos)
+        {
+          trafoi[i] = &ma->GetTrafo (ei, lh);
+          miri[i] = &(*trafoi[i]) (*iri[i], lh);
+        }
+      mesh_size[i] = geom.mesh_size[elnr];
+      jacdet[i] = geom.jacdet[elnr];
+      if (geom.affine[elnr])
+        jacinv[i].AssignMemory(dim, dim, geom.JacobianInverse(elnr).Data());
+      else
+        jacinv[i].AssignMemory(0, 0, nullptr);
+      tabi[i] = (geom.eltable[elnr] >= 0) ?
+        geom.tables[geom.eltable[elnr]].get() : nullptr;
+
+      // gradients of the fronts are constant on affine elements
+      auto nipt = iri[i]->Size();
+      agradphi_bot[i].AssignMemory(dim, IsAffine(i) ? 1 : nipt, lh);
+      agradphi_top[i].AssignMemory(dim, IsAffine(i) ? 1 : nipt, lh);
       adelta[i].AssignMemory(nipt, lh);
 
       switch(dim)
@@ -1190,8 +2401,27 @@ TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
 	    coef_top[i](k) = tent.ttop;
 	  }
         }
-      fe_nodal[i]->EvaluateGrad(*miri[i], coef_top[i], agradphi_top[i]);
-      fe_nodal[i]->EvaluateGrad(*miri[i], coef_bot[i], agradphi_bot[i]);
+      if (IsAffine(i))
+        {
+          HeapReset hr(lh);
+          FlatMatrix<> dshape(ndof, dim, lh);
+          fe_nodal[i]->CalcDShape(IntegrationPoint(0.0), dshape);
+          auto jinv = jacinv[i];
+          FlatVector<> gradref(dim, lh), grad(dim, lh);
+          gradref = Trans(dshape) * coef_top[i];
+          grad = Trans(jinv) * gradref;
+          for (int k : Range(dim))
+            agradphi_top[i](k,0) = grad(k);
+          gradref = Trans(dshape) * coef_bot[i];
+          grad = Trans(jinv) * gradref;
+          for (int k : Range(dim))
+            agradphi_bot[i](k,0) = grad(k);
+        }
+      else
+        {
+          fe_nodal[i]->EvaluateGrad(*miri[i], coef_top[i], agradphi_top[i]);
+          fe_nodal[i]->EvaluateGrad(*miri[i], coef_bot[i], agradphi_bot[i]);
+        }
 
       coef_delta[i].AssignMemory(ndof, lh);
       coef_delta[i] = coef_top[i] - coef_bot[i];
@@ -1199,76 +2429,79 @@ TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
     }
   nd = dofs.Size();
 
-  // precompute facet data for given tent
-  for (size_t i = 0; i < tent.internal_facets.Size(); i++)
+  // L2 spaces number the dofs of an element consecutively, so the dofs
+  // of a tent usually form a few contiguous blocks
+  size_t nblocks = 0;
+  bool valid = true;
+  for (size_t k = 0; k < dofs.Size(); k++)
+    {
+      valid = valid && (dofs[k] >= 0);
+      if (k == 0 || dofs[k] != dofs[k-1]+1)
+        nblocks++;
+    }
+  if (valid && 2*nblocks <= dofs.Size())
     {
-      ngcore::IVec<2> loc_facetnr;
+      dofblocks.Assign(nblocks, lh);
+      size_t b = 0;
+      for (size_t k = 0; k < dofs.Size(); k++)
+        if (k == 0 || dofs[k] != dofs[k-1]+1)
+          dofblocks[b++] = IntRange(dofs[k], dofs[k]+1);
+        else
+          dofblocks[b-1] = IntRange(dofblocks[b-1].First(), dofs[k]+1);
+    }
 
-      ArrayMem<int,2> elnums;
-      ArrayMem<int,2> elnums_per;
-      ma->GetFacetElements(tent.internal_facets[i], elnums);
+  // positions of the elements in the tent, sorted by element number
+  FlatArray<int> elorder(ntents, lh);
+  for (size_t i = 0; i < ntents; i++)
+    elorder[i] = i;
+  QuickSortI (tent.els, elorder);
+  auto LocalNr = [&] (int elnr) -> size_t
+    {
+      int * end = elorder.Data() + ntents;
+      int * pos = std::lower_bound
+        (elorder.Data(), end, elnr,
+         [&] (int i, int el) { return tent.els[i] < el; });
+      if (pos != end && tent.els[*pos] == elnr)
+        return *pos;
+      return size_t(-1);
+    };
 
-      bool periodic_facet = false;
-      int facet2;
-      if(elnums.Size() < 2)
-        {
-          facet2 = ma->GetPeriodicFacet(tent.internal_facets[i]);
-          if(facet2 != tent.internal_facets[i])
-            {
-              ma->GetFacetElements (facet2, elnums_per);
-              if (elnums_per.Size())
-                {
-                  periodic_facet = true;
-                  elnums.Append(elnums_per[0]);
-                }
-            }
-        }
-      
+  // precompute facet data for given tent
+  for (size_t i = 0; i < tent.internal_facets.Size(); i++)
+    {
+      const int fnr = tent.internal_facets[i];
       felpos[i] = ngcore::IVec<2,size_t>(size_t(-1));
-      for(int j : Range(elnums.Size()))
+      ftabi[i] = Vec<2,const BasisTable*>(nullptr);
+      for(int j : Range(2))
         {
-          felpos[i][j] = tent.els.Pos(elnums[j]);
+          const int elnr = geom.facet_els[fnr][j];
+          if (elnr == -1) continue;
+          felpos[i][j] = LocalNr(elnr);
           if(felpos[i][j] != size_t(-1))
             {
-              auto fnums = ma->GetElFacets (elnums[j]);
-              int fnr = tent.internal_facets[i];
-              if(periodic_facet)
-                {
-                  auto pos = fnums.Pos(facet2);
-                  if(pos != size_t(-1))
-                    fnr = facet2; // change facet nr to periodic
-                }
-              for (int k : Range(fnums.Size()))
-                if (fnums[k] == fnr) loc_facetnr[j] = k;
-
-              auto & trafo = *trafoi[felpos[i][j]];
-
-              auto vnums = ma->GetElVertices (elnums[j]);
-              Facet2ElementTrafo transform(trafo.GetElementType(), vnums);
-
-              auto etfacet = ElementTopology::
-		GetFacetType (trafo.GetElementType(), loc_facetnr[j]);
-
               if(j == 0)
-                {
-		  fir[i] = new (lh) SIMD_IntegrationRule (etfacet, 2*order+1);
-		  fir[i]->SetIRX(nullptr); // quick fix to avoid usage of TP elements (slows down)
-                }
-
-	      firi[i][j] = &transform(loc_facetnr[j], *fir[i], lh);
+                fir[i] = geom.fir[fnr];
+	      firi[i][j] = geom.firi[fnr][j];
+              if (geom.facettable[fnr][j] >= 0)
+                ftabi[i][j] = geom.tables[geom.facettable[fnr][j]].get();
 	      auto nipt = firi[i][j]->Size();
+              size_t elpos = felpos[i][j];
               if(j == 0)
                 {
-                  mfiri1[i] = &trafo(*firi[i][j], lh);
-                  mfiri1[i]->ComputeNormalsAndMeasure(trafo.GetElementType(),
-                                                      loc_facetnr[j]);
-                  anormals[i].AssignMemory(dim, nipt, lh);
+                  mfiri1[i] = geom.mfiri1[fnr];
+                  if (geom.private_trafos)
+                    {
+                      auto & eltrafo = *trafoi[elpos];
+                      mfiri1[i] = &eltrafo(*firi[i][j], lh);
+                      mfiri1[i]->ComputeNormalsAndMeasure
+                        (eltrafo.GetElementType(), geom.facet_locnr[fnr][j]);
+                    }
+                  anormals[i].AssignMemory(dim, nipt,
+                                           geom.normals[fnr].Data());
                   adelta_facet[i].AssignMemory(nipt, lh);
                   agradphi_botf1[i].AssignMemory(dim, nipt, lh);
                   agradphi_topf1[i].AssignMemory(dim, nipt, lh);
-		  anormals[i] = Trans(mfiri1[i]->GetNormals());
 
-                  size_t elpos = felpos[i][j];
                   fe_nodal[elpos]->Evaluate(*firi[i][j], coef_delta[elpos],
                                             adelta_facet[i]);
                   fe_nodal[elpos]->EvaluateGrad(*mfiri1[i], coef_bot[elpos],
@@ -1278,10 +2511,11 @@ TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
                 }
               else
                 {
-                  mfiri2[i] = &trafo(*firi[i][j], lh);
+                  mfiri2[i] = geom.mfiri2[fnr];
+                  if (geom.private_trafos)
+                    mfiri2[i] = &(*trafoi[elpos])(*firi[i][j], lh);
 		  agradphi_botf2[i].AssignMemory(dim, nipt, lh);
                   agradphi_topf2[i].AssignMemory(dim, nipt, lh);
-                  size_t elpos = felpos[i][j];
                   fe_nodal[elpos]->EvaluateGrad(*mfiri2[i], coef_bot[elpos],
                                                 agradphi_botf2[i]);
                   fe_nodal[elpos]->EvaluateGrad(*mfiri2[i], coef_top[elpos],
@@ -1293,3 +2527,67 @@ TentDataFE::TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh)
 }
 
 
+///////////// TentDataFECache //////////////////////////////////////////////
+
+void TentDataFECache::Build(const TentPitchedSlab & tps,
+                            const MeshGeometryData & geom)
+{
+  Clear();
+  const int nthreads = TaskManager::GetMaxThreads();
+  const size_t heapsize = maxmemory / nthreads;
+  heaps.SetSize(nthreads);
+  for (auto & heap : heaps)
+    heap = make_unique<LocalHeap>(heapsize, "TentDataFE cache");
+
+  fedata.SetSize(tps.GetNTents());
+  fedata = nullptr;
+  ParallelFor
+    (Range(fedata), [&] (int i)
+     {
+       LocalHeap & clh = *heaps[TaskManager::GetThreadId()];
+       void * mark = clh.GetPointer();
+       try
+         {
+           fedata[i] = new (clh) TentDataFE(tps.GetTent(i), geom, clh);
+         }
+       catch (const LocalHeapOverflow &)
+         {
+           // budget of this thread exhausted, recompute this tent on use
+           clh.CleanUp(mark);
+         }
+     });
+  slab_version = tps.GetSlabVersion();
+}
+
+void TentDataFECache::Clear()
+{
+  // TentDataFE holds some heap-allocated arrays
+  for (auto fd : fedata)
+    if (fd) fd->~TentDataFE();
+  fedata.SetSize(0);
+  heaps.SetSize(0);
+  slab_version = -1;
+}
+
+bool TentDataFECache::IsValid(const TentPitchedSlab & tps) const
+{
+  return slab_version == tps.GetSlabVersion();
+}
+
+size_t TentDataFECache::GetNCached() const
+{
+  size_t ncached = 0;
+  for (auto fd : fedata)
+    if (fd) ncached++;
+  return ncached;
+}
+
+size_t TentDataFECache::GetMemoryUsage() const
+{
+  if (heaps.Size() == 0) return 0;
+  size_t used = heaps.Size() * (maxmemory / heaps.Size());
+  for (auto & heap : heaps)
+    used -= heap->Available();
+  return used;
+}
+
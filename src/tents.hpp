@@ -17,6 +17,7 @@
 
 #include <solve.hpp>
 #include <h1lofe.hpp> // seems needed for ScalarFE (post 2021-06-22 NGSolve update)
+#include <queue>
 using namespace ngsolve;
 using namespace std;
 
@@ -33,39 +34,45 @@ using namespace std;
 /// the central vertex, and the heights (times) of its neighboring
 /// vertices.
 ///
+/// A tent is a view: its arrays point into one CSR table per attribute
+/// owned by the TentPitchedSlab, so a copy of a tent costs no allocation.
+/// The data of one propagation through the tent (fedata, time) is only
+/// set on such a copy, the tents of the slab stay untouched and may be
+/// used by several propagations at the same time.
+///
 
 
 class NGSTENT_API Tent {
 
 public:
-  Tent(const Array<int> &avmap) : vmap(avmap){}
+  Tent(const Array<int> &avmap) : elfnums(0, nullptr, nullptr), vmap(avmap){}
   Tent() = delete;
   int vertex;                 ///< central vertex
   double tbot, ttop;          ///< bottom and top times of central vertex
-  Array<int> nbv;             ///< neighbouring vertices of central vertex
-  Array<double> nbtime;       ///< height/time of neighbouring vertices
-  Array<int> els;             ///< all elements in the tent's vertex patch
-  Array<int> internal_facets; ///< all internal facets in the tent's vertex patch
+  FlatArray<int> nbv;         ///< neighbouring vertices of central vertex
+  FlatArray<double> nbtime;   ///< height/time of neighbouring vertices
+  FlatArray<int> els;         ///< all elements in the tent's vertex patch
+  FlatArray<int> internal_facets; ///< all internal facets in the tent's vertex patch
 
   /// elfnums[k] lists all internal facets of the k-th element of tent
-  Table<int> elfnums;         
+  FlatTable<int> elfnums;
 
   const Array<int> &vmap;     ///< vertex map for any periodicity identification
 
-  /// access to the finite element & dofs
-  mutable class TentDataFE * fedata = nullptr;
+  /// access to the finite element & dofs (set on a local copy)
+  class TentDataFE * fedata = nullptr;
 
   int level;                  ///< my parallel layer number in a mesh of tents
-  Array<int> dependent_tents; ///< these tents depend on me
+  FlatArray<int> dependent_tents; ///< these tents depend on me
 
   double maxslope = 0.0;      ///< maximal slope of the top advancing front
   double MaxSlope() const { return maxslope; }
 
   /// global physical time at vertex (stored in ConservationLaw::gftau)
-  mutable double * time;     
-  mutable double timebot;     ///< global physical bottom time at vertex
+  double * time = nullptr;
+  double timebot;             ///< global physical bottom time at vertex
 
-  void InitTent(shared_ptr<GridFunction> gftau) const
+  void InitTent(shared_ptr<GridFunction> gftau)
   {
     time = &(gftau->GetVector().FVDouble()(vertex));
     timebot = *time;
@@ -77,10 +84,262 @@ public:
 ostream & operator<< (ostream & ost, const Tent & tent);
 
 
+////////////////////////////////////////////////////////////////////////////
+///
+/// Shape functions of an L2 element tabulated in the points of an
+/// integration rule. The L2 basis only depends on the element type, the
+/// order and the ordering of the element vertices, so one table serves
+/// all elements of such a class. Evaluations then become small dense
+/// matrix products. The columns of the tables are the SIMD lanes of the
+/// integration points, padding lanes included.
+///
+class NGSTENT_API BasisTable
+{
+public:
+  /// ndof x nip, shape functions in the integration points
+  Matrix<> shape;
+  /// ndof x dim*nip, the k-th reference derivative of the shape functions
+  /// in the columns k*nip ... (k+1)*nip-1 (empty if not tabulated)
+  Matrix<> dshape;
+
+  BasisTable(const FiniteElement & fe, const SIMD_IntegrationRule & ir,
+             bool gradients);
+
+  /// values(l,k) = sum_j coefs(j,l) shape_j(x_k)
+  template <int W>
+  void Evaluate(FlatMatrixFixWidth<W> coefs,
+                FlatMatrix<SIMD<double>> values) const
+  {
+    FlatMatrix<> c(coefs.Height(), W, coefs.Data());
+    FlatMatrix<> v(W, shape.Width(), reinterpret_cast<double*>(values.Data()));
+    v = Trans(c) * shape;
+  }
+
+  /// coefs(j,l) += sum_k shape_j(x_k) values(l,k)
+  template <int W>
+  void AddTrans(FlatMatrix<SIMD<double>> values,
+                FlatMatrixFixWidth<W> coefs) const
+  {
+    FlatMatrix<> c(coefs.Height(), W, coefs.Data());
+    FlatMatrix<> v(W, shape.Width(), reinterpret_cast<double*>(values.Data()));
+    c += shape * Trans(v);
+  }
+
+  /// refvalues(l,r*nip+k) = sum_j coefs(j,l) dshape_j,r(x_k), the
+  /// gradients on the reference element
+  template <int W>
+  void EvaluateRefGrad(FlatMatrixFixWidth<W> coefs,
+                       FlatMatrix<SIMD<double>> refvalues) const
+  {
+    FlatMatrix<> c(coefs.Height(), W, coefs.Data());
+    FlatMatrix<> v(W, dshape.Width(),
+                   reinterpret_cast<double*>(refvalues.Data()));
+    v = Trans(c) * dshape;
+  }
+
+  /// coefs(j,l) += sum_k sum_r dshape_j,r(x_k) refvalues(l,r*nip+k), the
+  /// values must already be multiplied by the inverse Jacobian
+  template <int W>
+  void AddRefGradTrans(FlatMatrix<SIMD<double>> refvalues,
+                       FlatMatrixFixWidth<W> coefs) const
+  {
+    FlatMatrix<> c(coefs.Height(), W, coefs.Data());
+    FlatMatrix<> v(W, dshape.Width(),
+                   reinterpret_cast<double*>(refvalues.Data()));
+    c += dshape * Trans(v);
+  }
+
+  /// Evaluate for a compile-time number of dofs NDOF = shape.Height(),
+  /// keeping the coefficients and sums in registers
+  template <int W, int NDOF>
+  void EvaluateFix(FlatMatrixFixWidth<W> coefs,
+                   FlatMatrix<SIMD<double>> values) const
+  {
+    constexpr size_t nlanes = SIMD<double>::Size();
+    double c[NDOF][W];
+    for (int j = 0; j < NDOF; j++)
+      for (int l = 0; l < W; l++)
+        c[j][l] = coefs(j,l);
+    for (size_t k = 0; k < values.Width(); k++)
+      {
+        SIMD<double> sum[W];
+        for (int l = 0; l < W; l++)
+          sum[l] = SIMD<double>(0.0);
+        for (int j = 0; j < NDOF; j++)
+          {
+            SIMD<double> sj(&shape(j, k*nlanes));
+            for (int l = 0; l < W; l++)
+              sum[l] += c[j][l] * sj;
+          }
+        for (int l = 0; l < W; l++)
+          values(l,k) = sum[l];
+      }
+  }
+
+  /// AddTrans for a compile-time number of dofs
+  template <int W, int NDOF>
+  void AddTransFix(FlatMatrix<SIMD<double>> values,
+                   FlatMatrixFixWidth<W> coefs) const
+  {
+    AddTransFix<W,NDOF> (shape, values, coefs);
+  }
+
+  /// AddRefGradTrans for a compile-time number of dofs
+  template <int W, int NDOF>
+  void AddRefGradTransFix(FlatMatrix<SIMD<double>> refvalues,
+                          FlatMatrixFixWidth<W> coefs) const
+  {
+    AddTransFix<W,NDOF> (dshape, refvalues, coefs);
+  }
+
+private:
+  // coefs(j,l) += sum_k tab(j,k) values(l,k)
+  template <int W, int NDOF>
+  static void AddTransFix(const Matrix<> & tab,
+                          FlatMatrix<SIMD<double>> values,
+                          FlatMatrixFixWidth<W> coefs)
+  {
+    constexpr size_t nlanes = SIMD<double>::Size();
+    SIMD<double> sum[NDOF][W];
+    for (int j = 0; j < NDOF; j++)
+      for (int l = 0; l < W; l++)
+        sum[j][l] = SIMD<double>(0.0);
+    for (size_t k = 0; k < values.Width(); k++)
+      for (int j = 0; j < NDOF; j++)
+        {
+          SIMD<double> tj(&tab(j, k*nlanes));
+          for (int l = 0; l < W; l++)
+            sum[j][l] += tj * values(l,k);
+        }
+    for (int j = 0; j < NDOF; j++)
+      for (int l = 0; l < W; l++)
+        coefs(j,l) += HSum(sum[j][l]);
+  }
+};
+
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// Finite element & integration info of all elements and facets of the
+/// spatial mesh. This data does not depend on the tents, so it is computed
+/// once and shared by the TentDataFE of all tents containing an element.
+///
+class NGSTENT_API MeshGeometryData
+{
+  Array<unique_ptr<LocalHeap>> heaps; ///< storage, one heap per block
+  Array<size_t> heapused;             ///< bytes used in each heap
+
+public:
+  shared_ptr<FESpace> fes;
+  shared_ptr<MeshAccess> ma;
+
+  /// finite element of every element
+  Array<FiniteElement*> fe;
+  /// integration rule of every element
+  Array<SIMD_IntegrationRule*> ir;
+  /// mapped integration rule of every element
+  Array<SIMD_BaseMappedIntegrationRule*> mir;
+  /// element transformation of every element
+  Array<ElementTransformation*> trafo;
+  /// mesh size of every element
+  Array<double> mesh_size;
+
+  /// whether the element is an affine (straight-sided) simplex. The
+  /// kernels only use the constant Jacobian data of these. Unless
+  /// mapped_points is set, mir of an affine element is shared by all
+  /// elements of its type (mapped once by the first of them) and only
+  /// gives the equations the size and reference points of the rule.
+  Array<bool> affine;
+  /// inverse Jacobians of affine elements, dim x dim entries each
+  Array<double> jacinv;
+  /// absolute value of the Jacobi determinant of affine elements
+  Array<double> jacdet;
+
+  /// inverse diagonal of the mass matrix of every reference element
+  Array<FlatVector<double>> invdiag;
+  /// inverse diagonal mass matrix of every element with constant measure,
+  /// empty for curved elements
+  Array<FlatVector<double>> invmass;
+  /// cached (approximate) inverse mass matrix of every curved element,
+  /// empty otherwise. It is the approximation SolveM always used, kept
+  /// dense rather than factorizing the exact mass matrix so that results
+  /// do not change and a solve is a single matrix product.
+  Array<FlatMatrix<double>> curvedinv;
+  /// integration weight / measure in the IP's of every element
+  Array<FlatVector<SIMD<double>>> ipweight;
+
+  FlatMatrix<double> JacobianInverse(int elnr) const
+  {
+    const int dim = ma->GetDimension();
+    return FlatMatrix<double>(dim, dim,
+                              const_cast<double*>(&jacinv[elnr*dim*dim]));
+  }
+
+  /// the (at most two) elements of every facet, -1 if there is none;
+  /// for periodic facets the second element is the periodic neighbour
+  Array<ngcore::IVec<2>> facet_els;
+  /// local number of the facet in each of its elements
+  Array<ngcore::IVec<2>> facet_locnr;
+  /// integration rule of every facet
+  Array<SIMD_IntegrationRule*> fir;
+  /// facet integration rules transformed to local coordinates of the
+  /// two neighbouring elements
+  Array<Vec<2,const SIMD_IntegrationRule*>> firi;
+  /// facet integration rules mapped by the first element (with normals)
+  Array<SIMD_BaseMappedIntegrationRule*> mfiri1;
+  /// facet integration rules mapped by the second element
+  Array<SIMD_BaseMappedIntegrationRule*> mfiri2;
+  /// normal vectors in the facet IP's, size dim x nip
+  Array<FlatMatrix<SIMD<double>>> normals;
+
+  /// tabulated shape functions (only for L2HighOrderFESpace)
+  Array<unique_ptr<BasisTable>> tables;
+  /// table of every element in its IP's, -1 if none
+  Array<int> eltable;
+  /// tables of both neighbouring elements in the facet IP's, -1 if none
+  Array<ngcore::IVec<2>> facettable;
+
+  /// with private_trafos, every TentDataFE gets its own element
+  /// transformations and mapped rules instead of sharing trafo and mir.
+  /// Needed if data is attached to the transformations during the
+  /// propagation (the ProxyUserData of symbolic equations), since
+  /// different tents may be propagated concurrently.
+  bool private_trafos;
+  /// with mapped_points, the mapped rules of affine elements are stored
+  /// as well. Needed if the equation evaluates coefficient functions in
+  /// the mapped points (or if there are no tables to evaluate the
+  /// gradients with the constant Jacobian).
+  bool mapped_points;
+
+  /// number of every dof in the copy of the solution that is propagated
+  /// instead of it, numbered in the order the tents first visit the
+  /// dofs. Empty if the solution is propagated in place.
+  Array<int> dofmap;
+  /// slab version dofmap was built for
+  int dofmap_version = -1;
+
+  MeshGeometryData(shared_ptr<FESpace> afes, bool aprivate_trafos = false,
+                   bool amapped_points = true);
+
+  size_t GetMemoryUsage() const;
+
+private:
+  /// call func(i, lh) for all i in [0,n) in parallel blocks, each block
+  /// allocating into its own heap (which grows if it overflows)
+  template <typename TFUNC>
+  void BuildInBlocks(size_t n, size_t bytes_per_item, TFUNC func);
+};
+
+
 ////////////////////////////////////////////////////////////////////////////
 ///
 /// Class with dofs, finite element & integration info for a tent:
 ///
+/// The tent-independent element and facet data (fei, ..., normals) point
+/// into a MeshGeometryData, only the data depending on the tent heights
+/// is computed here (and the transformations and mapped rules, if the
+/// MeshGeometryData asks for private_trafos).
+///
 class NGSTENT_API TentDataFE
 {
 public:
@@ -88,17 +347,26 @@ public:
   Array<int> dofs;  ///< all interior and interface dof nums, size(dofs)=nd.
   /// ranges[k] = IntRange (of dof numbers) of k-th element of local matrix
   Array<IntRange> ranges;
+  /// dofs as contiguous ranges of global dof numbers (empty if the dofs
+  /// are too scattered), used by GatherDofs and ScatterDofs
+  Array<IntRange> dofblocks;
   /// finite elements for all elements in the tent
   Array<FiniteElement*> fei;
   /// integration rules for all elements in the tent
   Array<SIMD_IntegrationRule*> iri;
-  /// mapped integration rules for all elements in the tent
+  /// mapped integration rules for all elements in the tent (for affine
+  /// elements possibly only a representative, see MeshGeometryData::affine)
   Array<SIMD_BaseMappedIntegrationRule*> miri;
   /// element transformations for all elements in the tent
   Array<ElementTransformation*> trafoi;
   /// mesh size for each element
   Array<double> mesh_size;
+  /// |det| of the constant Jacobian of affine elements, 0 otherwise
+  Array<double> jacdet;
+  /// inverse of the constant Jacobian of affine elements, empty otherwise
+  Array<FlatMatrix<double>> jacinv;
   //// gradients of tent bottom at integration points (in possibly curved elements)
+  //// a single (constant) column for affine elements
   Array<FlatMatrix<SIMD<double>>> agradphi_bot;
   /// gradient of (tent top) the new advancing front in the IP's
   Array<FlatMatrix<SIMD<double>>> agradphi_top;
@@ -124,8 +392,129 @@ public:
   Array<FlatMatrix<SIMD<double>>> anormals;
   /// height of the tent in the IP's
   Array<FlatVector<SIMD<double>>> adelta_facet;
+  /// tabulated shape functions of the elements (nullptr if not available)
+  Array<const BasisTable*> tabi;
+  /// tabulated shape functions of the two neighbours in the facet IP's
+  Array<Vec<2,const BasisTable*>> ftabi;
+
+  TentDataFE(const Tent & tent, const MeshGeometryData & geom, LocalHeap & lh);
+
+  bool IsAffine(size_t i) const { return jacdet[i] > 0.0; }
 
-  TentDataFE(const Tent & tent, const FESpace & fes, LocalHeap & lh);
+  /// local = vec(dofs), copying whole dof blocks if possible
+  void GatherDofs(const BaseVector & vec, FlatVector<> local) const
+  {
+    if (!dofblocks.Size())
+      {
+        vec.GetIndirect(dofs, local);
+        return;
+      }
+    const size_t es = vec.EntrySize();
+    auto fv = vec.FVDouble();
+    size_t pos = 0;
+    for (auto block : dofblocks)
+      {
+        const size_t n = es * block.Size();
+        local.Range(pos, pos+n) = fv.Range(es*block.First(), es*block.Next());
+        pos += n;
+      }
+  }
+
+  /// vec(dofs) = local, copying whole dof blocks if possible
+  void ScatterDofs(BaseVector & vec, FlatVector<> local) const
+  {
+    if (!dofblocks.Size())
+      {
+        vec.SetIndirect(dofs, local);
+        return;
+      }
+    const size_t es = vec.EntrySize();
+    auto fv = vec.FVDouble();
+    size_t pos = 0;
+    for (auto block : dofblocks)
+      {
+        const size_t n = es * block.Size();
+        fv.Range(es*block.First(), es*block.Next()) = local.Range(pos, pos+n);
+        pos += n;
+      }
+  }
+
+  /// integration weight (times measure) in the k-th IP of the i-th element
+  SIMD<double> GetWeight(size_t i, size_t k) const
+  {
+    if (IsAffine(i))
+      return (*iri[i])[k].Weight() * jacdet[i];
+    return (*miri[i])[k].GetWeight();
+  }
+
+  /// measure of the i-th element in its first IP
+  double GetMeasure(size_t i) const
+  {
+    if (IsAffine(i))
+      return jacdet[i];
+    return (*miri[i])[0].GetMeasure()[0];
+  }
+
+  /// gradient of the front (1-tstar) phi_bot + tstar phi_top in the IP's
+  /// of the i-th element
+  void GradPhi(size_t i, double tstar, FlatMatrix<SIMD<double>> gradphi) const
+  {
+    auto bot = agradphi_bot[i];
+    auto top = agradphi_top[i];
+    if (bot.Width() == gradphi.Width())
+      gradphi = (1-tstar)*bot + tstar*top;
+    else
+      for (size_t k : Range(gradphi.Width()))
+        gradphi.Col(k) = (1-tstar)*bot.Col(0) + tstar*top.Col(0);
+  }
+
+  /// gradient of the tent height in the IP's of the i-th element
+  void GradDelta(size_t i, FlatMatrix<SIMD<double>> graddelta) const
+  {
+    auto bot = agradphi_bot[i];
+    auto top = agradphi_top[i];
+    if (bot.Width() == graddelta.Width())
+      graddelta = top - bot;
+    else
+      for (size_t k : Range(graddelta.Width()))
+        graddelta.Col(k) = top.Col(0) - bot.Col(0);
+  }
+};
+
+class TentPitchedSlab;
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// Cache of the TentDataFE of all tents in a slab.
+///
+/// The data is built once per pitched slab into per-thread heaps whose
+/// total size is limited by a memory budget. Tents whose data does not
+/// fit are not cached, and their TentDataFE must be recomputed on use.
+///
+class NGSTENT_API TentDataFECache
+{
+  size_t maxmemory;                   ///< total memory budget in bytes
+  Array<unique_ptr<LocalHeap>> heaps; ///< one heap per thread
+  Array<TentDataFE*> fedata;          ///< cached data (nullptr if not cached)
+  int slab_version = -1;              ///< slab version the cache was built for
+
+public:
+  TentDataFECache(size_t amaxmemory) : maxmemory(amaxmemory) { ; }
+  ~TentDataFECache() { Clear(); }
+
+  /// build TentDataFE for as many tents as the memory budget allows
+  void Build(const TentPitchedSlab & tps, const MeshGeometryData & geom);
+  void Clear();
+
+  /// whether the cache was built for the current pitching of tps
+  bool IsValid(const TentPitchedSlab & tps) const;
+
+  /// cached data of tent number i, or nullptr if it did not fit
+  TentDataFE * Get(int i) const { return fedata[i]; }
+
+  size_t GetNCached() const;
+  size_t GetMemoryUsage() const;
+  size_t GetMaxMemory() const { return maxmemory; }
 };
 
 ////////////////////////////////////////////////////////////////////////////
@@ -175,6 +564,13 @@ public:
 ////////////////////////////////////////////////////////////////////////////
 namespace ngstents{
   enum PitchingMethod {EVolGrad =1, EEdgeGrad};
+  enum TentOrdering {EPitchingOrder = 0, EMortonOrder, ERCMOrder};
+
+  /// number of heap allocations (operator new) of the calling thread,
+  /// only counted if built with NGSTENTS_COUNT_ALLOCATIONS, 0 otherwise
+  NGSTENT_API size_t ThreadAllocations();
+  /// whether this build counts the allocations (ThreadAllocations)
+  NGSTENT_API bool CountsAllocations();
 }
 
 class NGSTENT_API TentPitchedSlab {
@@ -182,18 +578,48 @@ protected:
   double dt;                              // time step between two time slices
   shared_ptr<CoefficientFunction> cmax;   // wavespeed
   ngstents::PitchingMethod method;
+  double max_wavespeed = 0;               // max of cmax the tents were pitched for
   bool has_been_pitched;                  // whether the slab has been already pitched
   Array<Tent*> tents;                     // tents between two time slices
   int nlayers;                            // number of layers in the time slab
+  int slab_version = 0;                   // increased whenever the tents change
+  // order of the tents within their levels (see ReorderTents)
+  ngstents::TentOrdering tent_ordering = ngstents::EPitchingOrder;
 
   Array<int> vmap;                        // vertex map for periodic boundaries
   LocalHeap lh;
 
+  // contiguous storage of the pitched tents: one block of Tent objects
+  // viewing one CSR table per tent attribute (see SetTents)
+  shared_ptr<Tent> tent_block;
+  Table<int> tent_nbv, tent_els, tent_internal_facets, tent_dependent;
+  Table<double> tent_nbtime;
+  Table<int> tent_elfnums;                // rows of the elfnums of all tents
+
+  // take over the tables of the tent attributes (row i belongs to tent i)
+  // and create the tents viewing them, the scalar attributes of the
+  // tents are left to the caller
+  void SetTents(Table<int> && nbv, Table<double> && nbtime, Table<int> && els,
+                Table<int> && internal_facets, Table<int> && dependent);
+  // delete the tents and their tables
+  void ReleaseTents();
+
+  // set up tent_dependency, slab_dependency and tent_layers from the tents
+  void BuildDependencies();
+
+  // maximum of cmax at the element centers, as seen by the pitcher
+  double MaxWavespeed();
+
 public:
   // access to base spatial mesh (public for export to Python visualization)
   shared_ptr<MeshAccess> ma;
   // Propagate methods need access to DAG of tent dependencies
   Table<int> tent_dependency;
+  // tents of the following slab depending on each tent, used to
+  // propagate through several slabs without a barrier in between
+  Table<int> slab_dependency;
+  // tents bucketed by their level, tents of one layer are independent
+  Table<int> tent_layers;
   // access to grad(phi) coefficient function
   shared_ptr<CoefficientFunction> cfgradphi = nullptr;
 
@@ -209,19 +635,42 @@ public:
   //calc_local_ct will indicate whether to use a local mesh-dependent
   //constant for the algorithm
   //global_ct is a globalwise constant that can be independently used
+  //parallel will pitch distance-2 independent sets of ready vertices
+  //concurrently instead of one vertex at a time
   
   template <int DIM>
-  bool PitchTents(const double dt, const bool calc_local_ct, const double global_ct = 1.0);
+  bool PitchTents(const double dt, const bool calc_local_ct, const double global_ct = 1.0,
+                  const bool parallel = false);
   
+  // write the pitched slab to a binary file, which can be loaded for
+  // the same mesh instead of pitching again
+  void Save(const string & filename) const;
+  // read a slab written by Save, checks that it belongs to the mesh and
+  // was pitched with the method of this slab, the wavespeed set here (if
+  // any) and the slab height dt (if positive)
+  void Load(const string & filename, double adt = 0);
+  // hash of the mesh topology and vertex coordinates
+  uint64_t MeshHash() const;
+
+  // renumber the tents of each level along a space-filling curve
+  // (EMortonOrder) or a reverse Cuthill-McKee numbering of the vertices
+  // (ERCMOrder), tents of lower levels keep coming first
+  void ReorderTents(ngstents::TentOrdering ordering);
+
   // Get object features
-  int GetNTents() { return tents.Size(); }
+  int GetNTents() const { return tents.Size(); }
   int GetNLayers() { return nlayers + 1; }
 
   void SetMaxWavespeed(const double c){cmax =  make_shared<ConstantCoefficientFunction>(c);}
   void SetMaxWavespeed(shared_ptr<CoefficientFunction> c){ cmax = c;}
   
   double GetSlabHeight() { return dt; }
-  const Tent & GetTent(int i) { return *tents[i];}
+  const Tent & GetTent(int i) const { return *tents[i];}
+
+  // Data derived from the tents (e.g. a TentDataFECache) is valid as
+  // long as the version does not change
+  int GetSlabVersion() const { return slab_version; }
+  ngstents::TentOrdering GetOrdering() const { return tent_ordering; }
 
   // Return  max(|| gradphi_top||, ||gradphi_bot||)
   double MaxSlope() const;
@@ -235,6 +684,77 @@ public:
   void SetPitchingMethod(ngstents::PitchingMethod amethod) {this->method = amethod;}
 };
 
+////////////////////////////////////////////////////////////////////////////
+///
+/// Bucketed priority queue of the vertices that are ready for pitching,
+/// keyed by the level of the tent to be pitched at each vertex.
+///
+/// Every queued vertex knows its bucket and its position in that bucket,
+/// so insertion, removal, level updates and extraction of a vertex of
+/// minimal level are all O(1) (the latter amortized).
+///
+
+class NGSTENT_API ReadyVertexQueue
+{
+  Array<Array<int>> buckets;  // buckets[l] = ready vertices of level l
+  Array<int> vlevel;          // bucket of each vertex (-1 if not queued)
+  Array<int> vpos;            // position of each queued vertex in its bucket
+  size_t minlevel = 0;        // all buckets below minlevel are empty
+  size_t nready = 0;          // number of queued vertices
+
+public:
+  ReadyVertexQueue(size_t nv) : vlevel(nv), vpos(nv) { vlevel = -1; }
+
+  size_t Size() const { return nready; }
+  bool Contains(const int v) const { return vlevel[v] != -1; }
+
+  // Insert v with the given level (or move it to that level if queued)
+  void Insert(const int v, const int level)
+  {
+    if (vlevel[v] == level) return;
+    if (Contains(v)) Remove(v);
+    if (size_t(level) >= buckets.Size())
+      buckets.SetSize(level+1);
+    vlevel[v] = level;
+    vpos[v] = buckets[level].Size();
+    buckets[level].Append(v);
+    minlevel = min(minlevel, size_t(level));
+    nready++;
+  }
+
+  // Remove v from the queue (nothing happens if v is not queued)
+  void Remove(const int v)
+  {
+    if (!Contains(v)) return;
+    auto & bucket = buckets[vlevel[v]];
+    const int last = bucket.Last();
+    bucket[vpos[v]] = last;
+    vpos[last] = vpos[v];
+    bucket.DeleteLast();
+    vlevel[v] = -1;
+    nready--;
+  }
+
+  // Remove and return a vertex of minimal level, nready must be > 0
+  int PopMin(int &level)
+  {
+    while (buckets[minlevel].Size() == 0) minlevel++;
+    const int v = buckets[minlevel][0];
+    level = minlevel;
+    Remove(v);
+    return v;
+  }
+
+  // Call func(v, level) for all queued vertices, by increasing level
+  template <typename TFUNC>
+  void IterateByLevel(TFUNC func) const
+  {
+    for (size_t l = minlevel; l < buckets.Size(); l++)
+      for (int v : buckets[l])
+        func(v, int(l));
+  }
+};
+
 //Abstract class with the interface of methods used for pitching a tent
 class NGSTENT_API TentSlabPitcher{
 protected:
@@ -254,6 +774,23 @@ protected:
   //global constant (defaulted to 1)
   double global_ctau;
   const ngstents::PitchingMethod method;
+  //main vertices that have not reached the top of the slab yet
+  Array<int> incomplete_vertices;
+  //position of each vertex in incomplete_vertices (-1 if complete)
+  Array<int> incomplete_pos;
+  //incomplete vertices that were found not ready, keyed by the ratio
+  //ktilde/refdt they had then. Entries whose ktilde changed since are
+  //stale and skipped, so GetReadyVertices only visits the vertices
+  //passing the (relaxed) advance criterion instead of all incomplete ones
+  struct Candidate
+  {
+    double ratio, ktilde;
+    int v;
+    bool operator< (const Candidate & other) const
+    { return ratio < other.ratio; }
+  };
+  std::priority_queue<Candidate> candidates;
+  void AddCandidate(const int v, const double ktilde_v);
   
   // Calculate c_tau to ensure causality (edge algo) / prevent locks (vol algo)
   virtual Table<double> CalcLocalCTau(LocalHeap& lh, const Table<int> &v2e) = 0;
@@ -278,30 +815,66 @@ public:
 		     bool calc_local_ctau, const double global_ct );
 
   // Compute vertex based max time-differences assumint tau=0
-  // corresponding to a non-periodic vertex
+  // corresponding to a non-periodic vertex. As the front starts flat,
+  // these are also the first ktilde of all candidates for pitching.
 
   void ComputeVerticesReferenceHeight(const Table<int> &v2v,
 				      const Table<int> &v2e,
 				      const FlatArray<double> &tau, LocalHeap &lh);
   
+  // Recompute ktilde at the neighbours of vi and update their
+  // position (or absence) in the queue of ready vertices
   void UpdateNeighbours(const int vi, const double adv_factor,
 			const Table<int> &v2v,const Table<int> &v2e,
                         const FlatArray<double> &tau,
 			const BitArray &complete_vertices,
-                        Array<double> &ktilde, BitArray &vertex_ready,
-                        Array<int> &ready_vertices, LocalHeap &lh);
+                        const FlatArray<int> &vertices_level,
+                        Array<double> &ktilde, ReadyVertexQueue &ready_vertices,
+                        LocalHeap &lh);
+
+  // Recompute ktilde at the neighbours of vi without touching the set
+  // of ready vertices. Only ktilde of the neighbours of vi is written,
+  // so it can be called concurrently for vertices at distance > 2.
+  void UpdateNeighboursHeight(const int vi, const Table<int> &v2v,
+                              const Table<int> &v2e, const FlatArray<double> &tau,
+                              const BitArray &complete_vertices,
+                              FlatArray<double> ktilde, LocalHeap &lh) const;
+
+  // Insert/remove the neighbours of vi into/from the queue of ready
+  // vertices according to their (already updated) ktilde and level.
+  // Removed ones become candidates for GetReadyVertices.
+  void UpdateNeighboursReadiness(const int vi, const double adv_factor,
+                                 const Table<int> &v2v,
+                                 const BitArray &complete_vertices,
+                                 const FlatArray<int> &vertices_level,
+                                 const FlatArray<double> &ktilde,
+                                 ReadyVertexQueue &ready_vertices);
+
+  // Greedily select ready vertices (lowest level first) such that no two
+  // of them share a neighbour, i.e. one colour class of a distance-2
+  // colouring of v2v. Tents at these vertices can be pitched concurrently.
+  // The selected vertices are removed from the queue.
+  void GetIndependentVertices(ReadyVertexQueue &ready_vertices,
+                              const Table<int> &v2v, BitArray &touched,
+                              Array<int> &indep_vertices) const;
   
+  // Mark vi as complete (tau[vi] = dt), keeping track of the incomplete ones
+  void SetVertexComplete(const int vi, BitArray &complete_vertices);
+
+  // Main vertices that have not reached the top of the slab yet
+  FlatArray<int> GetIncompleteVertices() const { return incomplete_vertices; }
+
   // Return a copy of vertex_refdt  (without any computation)
   Array<double> GetVerticesReferenceHeight(){ return Array<double>(vertex_refdt);}
 
   // Populate the set of ready vertices with vertices satisfying
   //   ktilde > adv_factor * refdt. Returns false if no such vertex was found.
+  //   Only the candidates passing this test are visited.
   [[nodiscard]] bool
   GetReadyVertices(double &adv_factor, bool reset_adv_factor,
                                       const FlatArray<double> &ktilde,
-				      const BitArray &complete_vertices,
-                                      BitArray &vertex_ready,
-				      Array<int> &ready_vertices);
+                                      const FlatArray<int> &vertices_level,
+				      ReadyVertexQueue &ready_vertices);
 
   // Given the current advancing (time) front, calculates the maximum
   // advance on a tent centered on vi that will still guarantee causality
@@ -310,8 +883,8 @@ public:
   GetPoleHeight(const int vi, const FlatArray<double> & tau,
 		FlatArray<int> nbv, FlatArray<int> nbe, LocalHeap & lh) const = 0;
 
-  //Returns the position in ready_vertices containing the vertex in which a tent will be pitched (and its level)
-  [[nodiscard]] std::tuple<int,int> PickNextVertexForPitching(const FlatArray<int> &ready_vertices, const FlatArray<double> &ktilde, const FlatArray<int> &vertices_level);
+  //Removes from ready_vertices the vertex in which a tent will be pitched and returns its level and number
+  [[nodiscard]] std::tuple<int,int> PickNextVertexForPitching(ReadyVertexQueue &ready_vertices);
 
   //////////////// For handling periodicity //////////////////////////////////
 
@@ -345,9 +918,9 @@ public:
 		       FlatArray<int> nbv,
                        FlatArray<int> nbe, LocalHeap & lh) const override;
 
-  // Calculate c_tau to prevent locks 
+  // Calculate c_tau to prevent locks (purely geometric, needs no heap)
 
-  Table<double> CalcLocalCTau(LocalHeap& lh, const Table<int> &v2e) override;
+  Table<double> CalcLocalCTau(LocalHeap&, const Table<int> &v2e) override;
 };
 
 template <int DIM>
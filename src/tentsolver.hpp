@@ -12,9 +12,15 @@ public:
 
   virtual void PropagateTent(const Tent & tent, BaseVector & hu,
 			     const BaseVector & hu0, LocalHeap & lh) = 0;
+
+  // Propagate the local dofs uhat (with initial data u0) of a tent
+  // from its bottom to its top. Expects tent.fedata and tent.time to be
+  // set on a local copy of the tent (see Tent).
+  virtual void PropagateLocal(const Tent & tent, FlatVector<> uhat,
+			      FlatVector<> u0, LocalHeap & lh) = 0;
 };
 
-template <typename TCONSLAW>
+template <typename TCONSLAW, int ORDER = -1>
 class SAT : public TentSolver
 {
 protected:
@@ -44,9 +50,12 @@ public:
 
   void PropagateTent(const Tent & tent, BaseVector & hu,
 		     const BaseVector & hu0, LocalHeap & lh) override;
+
+  void PropagateLocal(const Tent & tent, FlatVector<> uhat,
+		      FlatVector<> u0, LocalHeap & lh) override;
 };
 
-template <typename TCONSLAW>
+template <typename TCONSLAW, int ORDER = -1>
 class SARK : public TentSolver
 {
 protected:
@@ -135,6 +144,9 @@ public:
 
   void PropagateTent(const Tent & tent, BaseVector & hu,
 		     const BaseVector & hu0, LocalHeap & lh) override;
+
+  void PropagateLocal(const Tent & tent, FlatVector<> uhat,
+		      FlatVector<> u0, LocalHeap & lh) override;
 };
   
 #endif //TENTSOLVER_HPP
@@ -9,23 +9,41 @@ FlatVector<> AsFV (T & mat)
 };
 
 ////// structure-aware Taylor time stepping //////
-template <typename TCONSLAW> void SAT<TCONSLAW>::
+template <typename TCONSLAW, int ORDER> void SAT<TCONSLAW, ORDER>::
 PropagateTent(const Tent & tent, BaseVector & hu,
 	      const BaseVector & hu0, LocalHeap & lh)
 {
   // static Timer tproptent ("SAT::Propagate Tent", 2);
   // ThreadRegionTimer reg(tproptent, TaskManager::GetThreadId());
 
-  tent.fedata = new (lh) TentDataFE(tent, *(tcl->fes), lh);
-  tent.InitTent(tcl->gftau);
+  // a local view of the tent carries the data of this propagation,
+  // use cached data if the caller provided it
+  Tent ltent = tent;
+  if (!ltent.fedata)
+    ltent.fedata = new (lh) TentDataFE(tent, *(tcl->geomdata), lh);
+  ltent.InitTent(tcl->gftau);
 
-  int ndof = tent.fedata->nd;
+  int ndof = ltent.fedata->nd;
   FlatMatrixFixWidth<COMP> local_uhat(ndof,lh);
   FlatMatrixFixWidth<COMP> local_u0(ndof,lh);
-  FlatMatrixFixWidth<COMP> local_u0temp(ndof,lh);
-  hu.GetIndirect(tent.fedata->dofs, AsFV(local_uhat));
-  hu0.GetIndirect(tent.fedata->dofs, AsFV(local_u0));
-  local_u0temp = local_u0;
+  ltent.fedata->GatherDofs(hu, AsFV(local_uhat));
+  ltent.fedata->GatherDofs(hu0, AsFV(local_u0));
+
+  PropagateLocal(ltent, AsFV(local_uhat), AsFV(local_u0), lh);
+
+  ltent.fedata->ScatterDofs(hu, AsFV(local_uhat));
+  ltent.SetFinalTime();
+};
+
+template <typename TCONSLAW, int ORDER> void SAT<TCONSLAW, ORDER>::
+PropagateLocal(const Tent & tent, FlatVector<> uhat,
+	       FlatVector<> u0, LocalHeap & lh)
+{
+  HeapReset hr(lh);
+  int ndof = tent.fedata->nd;
+  FlatMatrixFixWidth<COMP> local_uhat(ndof, uhat.Data());
+  FlatMatrixFixWidth<COMP> local_u0temp(ndof, u0.Data());
+  FlatMatrixFixWidth<COMP> local_u0(ndof,lh);
   
   FlatMatrixFixWidth<COMP> local_uhat1(ndof,lh);
   FlatMatrixFixWidth<COMP> local_u(ndof,lh);
@@ -39,52 +57,67 @@ PropagateTent(const Tent & tent, BaseVector & hu,
       local_u0 = local_u0temp;
       for(int k : Range(stages))
   	{
-  	  tcl->Cyl2Tent(tent, j*taustar, local_uhat1, local_u, lh);
-  	  tcl->CalcFluxTent(tent, local_u, local_u0, local_uhat1, j*taustar, k, lh);
+  	  tcl->template Cyl2Tent<ORDER>(tent, j*taustar, local_uhat1, local_u, lh);
+  	  tcl->template CalcFluxTent<ORDER>(tent, local_u, local_u0, local_uhat1, j*taustar, k, lh);
   	  local_uhat1 *= 1.0/(k+1);
   	  fac *= taustar;
   	  local_uhat += fac*local_uhat1;           
   
   	  if(k < stages-1)
   	    {
-  	      tcl->ApplyM1(tent, j*taustar, local_u, local_help, lh);
+  	      tcl->template ApplyM1<ORDER>(tent, j*taustar, local_u, local_help, lh);
   	      local_uhat1 += local_help;
   	    }
   	  local_u0 = 0.0;
   	}
     }
-  hu.SetIndirect(tent.fedata->dofs, AsFV(local_uhat));
-  tent.fedata = nullptr;
-  tent.SetFinalTime();
 };
 
 ////// structure-aware Runge-Kutta time stepping //////
-template <typename TCONSLAW> void SARK<TCONSLAW>::
+template <typename TCONSLAW, int ORDER> void SARK<TCONSLAW, ORDER>::
 PropagateTent(const Tent & tent, BaseVector & hu,
 	      const BaseVector & hu0, LocalHeap & lh)
 {
   // static Timer tproptent ("SARK::Propagate Tent", 2);
   // ThreadRegionTimer reg(tproptent, TaskManager::GetThreadId());
 
-  tent.fedata = new (lh) TentDataFE(tent, *(tcl->fes), lh);
-  tent.InitTent(tcl->gftau);
+  // a local view of the tent carries the data of this propagation,
+  // use cached data if the caller provided it
+  Tent ltent = tent;
+  if (!ltent.fedata)
+    ltent.fedata = new (lh) TentDataFE(tent, *(tcl->geomdata), lh);
+  ltent.InitTent(tcl->gftau);
 
-  const int ndof = tent.fedata->nd;
-  FlatMatrixFixWidth<COMP> local_u0(ndof,lh);
+  const int ndof = ltent.fedata->nd;
   FlatMatrixFixWidth<COMP> local_Gu0(ndof,lh);
   FlatMatrixFixWidth<COMP> local_init(ndof,lh);
 
-  hu.GetIndirect(tent.fedata->dofs, AsFV(local_Gu0));
-  hu0.GetIndirect(tent.fedata->dofs, AsFV(local_init));
+  ltent.fedata->GatherDofs(hu, AsFV(local_Gu0));
+  ltent.fedata->GatherDofs(hu0, AsFV(local_init));
+
+  PropagateLocal(ltent, AsFV(local_Gu0), AsFV(local_init), lh);
+
+  ltent.fedata->ScatterDofs(hu, AsFV(local_Gu0));
+  ltent.SetFinalTime();
+};
+
+template <typename TCONSLAW, int ORDER> void SARK<TCONSLAW, ORDER>::
+PropagateLocal(const Tent & tent, FlatVector<> uhat,
+	       FlatVector<> u0, LocalHeap & lh)
+{
+  HeapReset hr(lh);
+  const int ndof = tent.fedata->nd;
+  FlatMatrixFixWidth<COMP> local_Gu0(ndof, uhat.Data());
+  FlatMatrixFixWidth<COMP> local_init(ndof, u0.Data());
 
   FlatMatrixFixWidth<COMP> local_u(ndof,lh);
   FlatMatrixFixWidth<COMP> local_help(ndof,lh);
   FlatMatrixFixWidth<COMP> local_flux(ndof,lh);
 
-  Array<FlatMatrixFixWidth<COMP>> U(stages);
-  Array<FlatMatrixFixWidth<COMP>> u(stages);
-  Array<FlatMatrixFixWidth<COMP>> M1u(stages);
-  Array<FlatMatrixFixWidth<COMP>> fu(stages);
+  FlatArray<FlatMatrixFixWidth<COMP>> U(stages, lh);
+  FlatArray<FlatMatrixFixWidth<COMP>> u(stages, lh);
+  FlatArray<FlatMatrixFixWidth<COMP>> M1u(stages, lh);
+  FlatArray<FlatMatrixFixWidth<COMP>> fu(stages, lh);
   for ( auto i : Range(stages))
     {
       U[i].AssignMemory(ndof, lh);
@@ -126,10 +159,18 @@ PropagateTent(const Tent & tent, BaseVector & hu,
 	      U[s] += taustar * acoeff(s,i) * fu[i];
 	      U[s] += taustar * dcoeff(s,i) * M1u[i];
 	    }
-	  tcl->Cyl2Tent (tent, j*taustar, U[s], u[s], lh);
-	  tcl->ApplyM1(tent, j*taustar, u[s], M1u[s], lh);
-	  tcl->CalcFluxTent(tent, u[s], local_init, fu[s],
-			    (j+ccoeff(s))*taustar, 0, lh);
+	  if (tcl->fused_stages)
+	    tcl->template CalcStageTent<ORDER> (tent, j*taustar,
+						(j+ccoeff(s))*taustar, U[s],
+						local_init, u[s], M1u[s], fu[s],
+						0, lh);
+	  else
+	    {
+	      tcl->template Cyl2Tent<ORDER> (tent, j*taustar, U[s], u[s], lh);
+	      tcl->template ApplyM1<ORDER> (tent, j*taustar, u[s], M1u[s], lh);
+	      tcl->template CalcFluxTent<ORDER> (tent, u[s], local_init, fu[s],
+						 (j+ccoeff(s))*taustar, 0, lh);
+	    }
 	  Uhat += taustar * bcoeff(s) * fu[s];
 	}
       local_Gu0 = Uhat;
@@ -150,7 +191,7 @@ PropagateTent(const Tent & tent, BaseVector & hu,
 	  //                        tent, U[0], res, (j+1)*taustar, lh);
 	  /////// use dUhatdt as approximation at the initial time
 	  tcl->CalcEntropyResidualTent(tent, U[0], dUhatdt, res, local_init, j*taustar, lh);
-	  hres->SetIndirect(tent.fedata->dofs,AsFV(res));
+	  tent.fedata->ScatterDofs(*hres, AsFV(res));
 	  double nu_tent = tcl->CalcViscosityCoefficientTent(tent, U[0], res,j*taustar, lh);
 
 	  local_nu = nu_tent;
@@ -160,14 +201,14 @@ PropagateTent(const Tent & tent, BaseVector & hu,
 	      steps_visc = max(1.0,ceil(steps_visc));
 	      double tau_visc = taustar/steps_visc;
 	      // store boundary conditions in local_help
-	      tcl->Cyl2Tent (tent, (j+1)*taustar, local_Gu0, local_u, lh);
+	      tcl->template Cyl2Tent<ORDER> (tent, (j+1)*taustar, local_Gu0, local_u, lh);
 	      local_help = local_u;
 	      for (int k = 0; k < steps_visc; k++)
 		{
 		  tcl->CalcViscosityTent (tent, local_u, local_help, local_nu, local_flux, lh);
 		  local_u -= tau_visc * local_flux;
 		}
-	      tcl->Tent2Cyl(tent, (j+1)*taustar, local_u, local_Gu0, true, lh);
+	      tcl->template Tent2Cyl<ORDER>(tent, (j+1)*taustar, local_u, local_Gu0, true, lh);
 	    }
 	}
     }
@@ -184,10 +225,6 @@ PropagateTent(const Tent & tent, BaseVector & hu,
   //   *testout << "bot, top : " << norm_bot << ", " << norm_top << endl;
   // if(norm_top/norm_bot < 0.9)
   //   *testout << "bot, top : " << norm_bot << ", " << norm_top << endl;
-
-  hu.SetIndirect(tent.fedata->dofs, AsFV(local_Gu0));
-  tent.fedata = nullptr;
-  tent.SetFinalTime();
 };
 
 
@@ -57,7 +57,7 @@ void Visualization3D::SetInitialHd(
 
 
 void Visualization3D::SetForTent(
-    Tent &tent, shared_ptr<GridFunction> gfu,
+    const Tent &tent, shared_ptr<GridFunction> gfu,
     shared_ptr<GridFunction> hdgf, LocalHeap & lh)
 {
     auto fes = gfu->GetFESpace();
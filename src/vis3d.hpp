@@ -19,7 +19,7 @@ public:
 
   // Interpolate the solution on elements of a tent into a temp H1 space
   // Then transfer the tent vertex value to the 3D H1 space
-  void SetForTent(Tent &tent, shared_ptr<GridFunction> gfu,
+  void SetForTent(const Tent &tent, shared_ptr<GridFunction> gfu,
                   shared_ptr<GridFunction> hdgf, LocalHeap & lh);
 
 private:
@@ -14,6 +14,8 @@ class Wave : public T_ConservationLaw<Wave<D>, D, D+1, 0>
   typedef T_ConservationLaw<Wave<D>, D, D+1, 0> BASE;
   
 public:
+  static constexpr bool linear = true;
+
   Wave (const shared_ptr<GridFunction> & agfu,
 	const shared_ptr<TentPitchedSlab> & atps)
     : BASE (agfu, atps, "wave")
@@ -30,8 +32,12 @@ public:
     use_mu_eps = true;
     cf_mu = mu;
     cf_eps = eps;
+    // the coefficients are evaluated in the mapped points
+    BASE::ResetGeometryData();
   }
 
+  bool UsesMappedPoints() const { return use_mu_eps; }
+
   // solve for û: Û = ĝ(x̂, t̂, û) - ∇̂ φ(x̂, t̂) ⋅ f̂(x̂, t̂, û)
   // at all points in an integration rule
   template <typename T>
@@ -130,3 +130,38 @@ def test_3D_edge_causal():
     expected = 1.0 / c
     msg = "max slope {} exceeded {}".format(maxslope, expected)
     assert maxslope <= expected, msg
+
+
+def test_2D_edge_parallel_causal():
+    mesh = Get2DMesh()
+    dt = 10
+    c = 1
+    global_ct = 0.999
+    method = "edge"
+    heapsize = 5 * 1000 * 1000
+    tentslab = TentSlab(mesh, method, heapsize)
+    tentslab.SetMaxWavespeed(c)
+    success = tentslab.PitchTents(dt, local_ct=True, global_ct=global_ct,
+                                  parallel=True)
+    assert success, "Slab could not be pitched"
+    maxslope = tentslab.MaxSlope()
+    expected = 1.0 / c
+    msg = "max slope {} exceeded {}".format(maxslope, expected)
+    assert maxslope <= expected, msg
+
+
+def test_3D_vol_parallel_causal():
+    mesh = Get3DMesh()
+    dt = 1
+    c = 1
+    global_ct = 0.999
+    method = "vol"
+    heapsize = 5 * 1000 * 1000
+    tentslab = TentSlab(mesh, method, heapsize)
+    tentslab.SetMaxWavespeed(c)
+    success = tentslab.PitchTents(dt, global_ct=global_ct, parallel=True)
+    assert success, "Slab could not be pitched"
+    maxslope = tentslab.MaxSlope()
+    expected = 1.0 / c
+    msg = "max slope {} exceeded {}".format(maxslope, expected)
+    assert maxslope <= expected, msg
@@ -0,0 +1,325 @@
+"""
+Module test_propagate_options
+
+Checks that optional propagation features reproduce the results of
+the default propagation of a wave problem.
+"""
+from math import pi, dist
+import pytest
+from ngsolve import (Mesh, CoefficientFunction, GridFunction, L2, cos, exp,
+                     x, y, TaskManager, Integrate, InnerProduct, sqrt)
+from netgen.geom2d import SplineGeometry
+from ngstents import TentSlab
+from ngstents.conslaw import Wave, Burgers
+
+
+def GetRectangle(curve=None):
+    geom = SplineGeometry()
+    geom.AddRectangle(p1=(0, 0), p2=(pi, pi), bc="reflect")
+    mesh = Mesh(geom.GenerateMesh(maxh=0.5))
+    if curve:
+        mesh.Curve(curve)
+    return mesh
+
+
+def GetWave(ordering=None, mesh=None, initial=cos(x)*cos(y)):
+    if mesh is None:
+        mesh = GetRectangle()
+    ts = TentSlab(mesh, method="edge", heapsize=10*1000*1000)
+    ts.SetMaxWavespeed(1)
+    ts.PitchTents(dt=0.2, local_ct=True, global_ct=2/3)
+    if ordering:
+        ts.ReorderTents(ordering)
+    order = 2
+    V = L2(mesh, order=order, dim=mesh.dim+1)
+    u = GridFunction(V, "u")
+    wave = Wave(u, ts, reflect=mesh.Boundaries("reflect"))
+    wave.SetTentSolver("SAT", stages=order+1, substeps=2*order)
+    wave.SetInitial(CoefficientFunction((0, 0, initial)))
+    return wave
+
+
+def Run(wave, nsteps=4):
+    with TaskManager():
+        for i in range(nsteps):
+            wave.Propagate()
+    return wave.sol
+
+
+def Difference(gfu, gfv):
+    mesh = gfu.space.mesh
+    return sqrt(Integrate(InnerProduct(gfu-gfv, gfu-gfv), mesh))
+
+
+def test_tentdata_cache():
+    ref = Run(GetWave())
+    wave = GetWave()
+    wave.SetTentDataCache(maxmemory=100*1000*1000)
+    sol = Run(wave)
+    info = wave.TentDataCacheInfo()
+    assert info["ncached"] == info["ntents"]
+    assert info["geometry_memory"] > 0
+    assert Difference(ref, sol) < 1e-12
+    # further steps reuse the cached tents instead of adding new ones
+    with TaskManager():
+        wave.Propagate()
+    assert wave.TentDataCacheInfo() == info
+
+
+def test_allocation_free_tents():
+    wave = GetWave()
+    wave.SetTentDataCache(maxmemory=100*1000*1000)
+    Run(wave)
+    stats = wave.SchedulerStats()
+    if not stats["allocations_counted"]:
+        pytest.skip("needs a build with NGSTENTS_COUNT_ALLOCATIONS")
+    # with all tents cached, propagating a tent allocates nothing
+    assert stats["allocations"] == 0
+
+
+def test_tentdata_cache_budget():
+    ref = Run(GetWave())
+    wave = GetWave()
+    # a tiny budget only fits a few tents, the others are recomputed
+    wave.SetTentDataCache(maxmemory=100*1000)
+    sol = Run(wave)
+    info = wave.TentDataCacheInfo()
+    assert info["ncached"] < info["ntents"]
+    assert info["memory"] <= info["maxmemory"]
+    assert Difference(ref, sol) < 1e-12
+
+
+def test_curved_mesh():
+    # on straight elements the approximate inverse mass matrix of curved
+    # elements is exact, so curving a rectangle changes nothing
+    ref = Run(GetWave())
+    sol = Run(GetWave(mesh=GetRectangle(curve=3)))
+    assert Difference(ref, sol) < 1e-10
+    # on a disk the cached inverse is used by cached and uncached tents
+    # alike, and the upwind scheme does not gain energy
+    geom = SplineGeometry()
+    geom.AddCircle((0, 0), 1, bc="reflect")
+    mesh = Mesh(geom.GenerateMesh(maxh=0.3))
+    mesh.Curve(3)
+    initial = exp(-20*(x*x+y*y))
+    ref = GetWave(mesh=mesh, initial=initial)
+    energy0 = Integrate(InnerProduct(ref.sol, ref.sol), mesh)
+    Run(ref)
+    energy = Integrate(InnerProduct(ref.sol, ref.sol), mesh)
+    assert 0.9 * energy0 < energy < energy0 * (1 + 1e-8)
+    wave = GetWave(mesh=mesh, initial=initial)
+    wave.SetTentDataCache(maxmemory=100*1000*1000)
+    assert Difference(ref.sol, Run(wave)) < 1e-12
+
+
+def test_fused_sark_stages():
+    # the fused stage kernel reproduces the separate kernels
+    sols = []
+    for fused in [True, False]:
+        wave = GetWave()
+        wave.SetTentSolver("SARK", stages=3, substeps=4)
+        wave.SetFusedStages(fused)
+        sols.append(Run(wave))
+    assert Difference(sols[0], sols[1]) < 1e-12
+
+
+def test_precomputed_propagator():
+    ref = Run(GetWave())
+    wave = GetWave()
+    wave.SetPrecomputedPropagator()
+    sol = Run(wave)
+    assert Difference(ref, sol) < 1e-10
+    # boundary values set afterwards are not silently ignored
+    wave.SetBoundaryCF(CoefficientFunction((0, 0, 0)))
+    with pytest.raises(Exception):
+        wave.Propagate()
+    # nonlinear equations have no propagator matrix
+    mesh = wave.sol.space.mesh
+    ts = TentSlab(mesh, method="edge")
+    ts.SetMaxWavespeed(1)
+    ts.PitchTents(dt=0.2)
+    burgers = Burgers(GridFunction(L2(mesh, order=1)), ts)
+    with pytest.raises(Exception):
+        burgers.SetPrecomputedPropagator()
+
+
+def RunEnsemble(cl, sols, nsteps=4):
+    with TaskManager():
+        for i in range(nsteps):
+            cl.PropagateEnsemble(sols)
+
+
+def test_propagate_ensemble():
+    ref = Run(GetWave())
+    for propagator in [False, True]:
+        wave = GetWave()
+        V = wave.sol.space
+        u1, u2 = GridFunction(V), GridFunction(V)
+        u1.vec.data = wave.sol.vec
+        u2.vec.data = 2 * wave.sol.vec
+        if propagator:
+            wave.SetPrecomputedPropagator()
+        RunEnsemble(wave, [u1, u2])
+        assert Difference(ref, u1) < 1e-10
+        assert Difference(u2, 2 * ref) < 1e-10
+    # nonlinear equations share the tent data between the members, each
+    # member is propagated as by Propagate (also with reordered tents)
+    for ordering in [None, "morton"]:
+        refs = []
+        for scale in [1, 0.5]:
+            burgers = GetBurgers(ordering)
+            burgers.sol.vec.data = scale * burgers.sol.vec
+            refs.append(Run(burgers))
+        burgers = GetBurgers(ordering)
+        V = burgers.sol.space
+        sols = [GridFunction(V), GridFunction(V)]
+        for sol, scale in zip(sols, [1, 0.5]):
+            sol.vec.data = scale * burgers.sol.vec
+        RunEnsemble(burgers, sols)
+        for sol, ref in zip(sols, refs):
+            assert Difference(ref, sol) < 1e-12
+
+
+def test_propagate_multislab():
+    ref = Run(GetWave())
+    wave = GetWave()
+    with TaskManager():
+        wave.Propagate(nslabs=4)
+    # the tents of all slabs are run by one scheduler call
+    assert wave.SchedulerStats()["ntasks"] == 4 * wave.tentslab.GetNTents()
+    assert Difference(ref, wave.sol) < 1e-12
+
+
+def test_scheduler_stats():
+    wave = GetWave()
+    Run(wave, nsteps=1)
+    stats = wave.SchedulerStats()
+    assert stats["ntasks"] == wave.tentslab.GetNTents()
+    assert 0 < stats["max_queue_depth"] <= stats["ntasks"]
+    assert stats["steals"] <= stats["ntasks"]
+    assert "allocations" in stats
+
+
+def test_level_scheduler():
+    ref = Run(GetWave())
+    wave = GetWave()
+    wave.SetScheduler("levels")
+    sol = Run(wave)
+    stats = wave.SchedulerStats()
+    assert stats["ntasks"] == wave.tentslab.GetNTents()
+    # every layer is run at once, the widest one is the deepest queue
+    ts = wave.tentslab
+    levels = [ts.GetTent(i).level for i in range(ts.GetNTents())]
+    widest = max(levels.count(lev) for lev in set(levels))
+    assert stats["max_queue_depth"] == widest
+    assert Difference(ref, sol) < 1e-12
+
+
+def test_static_scheduler():
+    ref = Run(GetWave())
+    wave = GetWave()
+    wave.SetScheduler("static")
+    sol = Run(wave)
+    stats = wave.SchedulerStats()
+    assert stats["ntasks"] == wave.tentslab.GetNTents()
+    # idle threads may only take over tents of other lists
+    assert stats["steals"] <= stats["ntasks"]
+    assert Difference(ref, sol) < 1e-12
+
+
+def test_priority_scheduler():
+    ref = Run(GetWave())
+    wave = GetWave()
+    wave.SetScheduler("priority")
+    # a tent is at least as urgent as the tents waiting for it, and the
+    # critical path starts at a tent of the first level
+    ts = wave.tentslab
+    bands = wave.PriorityBands()
+    assert len(bands) == ts.GetNTents()
+    for i in range(ts.GetNTents()):
+        for j in ts.GetTent(i).dependent_tents:
+            assert bands[i] <= bands[j]
+    assert any(bands[i] == 0 and ts.GetTent(i).level == 0
+               for i in range(ts.GetNTents()))
+    sol = Run(wave)
+    assert wave.SchedulerStats()["ntasks"] == ts.GetNTents()
+    assert Difference(ref, sol) < 1e-12
+    # without threads the serial loop follows the bands
+    wave = GetWave()
+    wave.SetScheduler("priority")
+    for i in range(4):
+        wave.Propagate()
+    assert Difference(ref, wave.sol) < 1e-12
+
+
+def test_tent_agglomeration():
+    ref = Run(GetWave())
+    nclusters = []
+    for maxels in [10, 30, 90]:
+        wave = GetWave()
+        wave.SetTentAgglomeration(maxels=maxels)
+        sol = Run(wave)
+        assert Difference(ref, sol) < 1e-12
+        ts = wave.tentslab
+        ntents = ts.GetNTents()
+        nels = sum(len(ts.GetTent(i).els) for i in range(ntents))
+        # one task per cluster of at most maxels elements
+        ntasks = wave.SchedulerStats()["ntasks"]
+        assert nels / maxels <= ntasks < ntents
+        nclusters.append(ntasks)
+    # larger clusters give fewer tasks
+    assert nclusters == sorted(nclusters, reverse=True)
+    assert nclusters[0] > nclusters[-1]
+
+
+def GetBurgers(ordering=None):
+    geom = SplineGeometry()
+    geom.AddRectangle((0, 0), (1, 1), bc=1)
+    mesh = Mesh(geom.GenerateMesh(maxh=0.2))
+    ts = TentSlab(mesh, method="edge", heapsize=10*1000*1000)
+    ts.SetMaxWavespeed(4)
+    ts.PitchTents(dt=0.025)
+    if ordering:
+        ts.ReorderTents(ordering)
+    order = 2
+    burgers = Burgers(GridFunction(L2(mesh, order=order)), ts)
+    burgers.SetTentSolver("SARK", substeps=order*order)
+    burgers.SetInitial(exp(-50*((x-0.3)*(x-0.3)+(y-0.3)*(y-0.3))))
+    return burgers
+
+
+def TentJumps(ts):
+    # summed distance between the central vertices of consecutive tents
+    # of the same level
+    mesh = ts.mesh
+    jumps = 0
+    for i in range(1, ts.GetNTents()):
+        t0, t1 = ts.GetTent(i-1), ts.GetTent(i)
+        if t0.level == t1.level:
+            p0 = mesh.vertices[t0.vertex].point
+            p1 = mesh.vertices[t1.vertex].point
+            jumps += dist(p0, p1)
+    return jumps
+
+
+def test_reorder_tents():
+    wave = GetWave()
+    jumps = TentJumps(wave.tentslab)
+    ref = Run(wave)
+    for ordering in ["morton", "rcm"]:
+        wave = GetWave(ordering)
+        levels = [wave.tentslab.GetTent(i).level
+                  for i in range(wave.tentslab.GetNTents())]
+        assert levels == sorted(levels)
+        # tents following each other are closer than in pitching order
+        assert TentJumps(wave.tentslab) < jumps
+        assert Difference(ref, Run(wave)) < 1e-12
+    # the entropy residual of nonlinear equations is renumbered as well
+    ref = GetBurgers()
+    Run(ref)
+    for ordering in ["morton", "rcm"]:
+        burgers = GetBurgers(ordering)
+        Run(burgers)
+        assert Difference(ref.sol, burgers.sol) < 1e-12
+        assert Difference(ref.res, burgers.res) < 1e-12
+
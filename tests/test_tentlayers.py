@@ -1,3 +1,4 @@
+import pytest
 from ngsolve import Mesh
 from ngstents import TentSlab
 from netgen.geom2d import unit_square
@@ -16,3 +17,49 @@ def test_tent_nlayers():
     tents = [tentslab.GetTent(i) for i in range(tentslab.GetNTents())]
     layers = set([t.level for t in tents])
     assert len(layers) == tentslab.GetNLayers(), "Incorrect number of layers"
+
+
+def test_save_load(tmp_path):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=.3))
+    tentslab = TentSlab(mesh, "edge", 5 * 1000 * 1000)
+    tentslab.SetMaxWavespeed(1)
+    tentslab.PitchTents(0.5, local_ct=True)
+    filename = str(tmp_path / "slab.tents")
+    tentslab.Save(filename)
+
+    loaded = TentSlab(mesh, "edge", 5 * 1000 * 1000)
+    loaded.Load(filename)
+    assert loaded.GetNTents() == tentslab.GetNTents()
+    assert loaded.GetNLayers() == tentslab.GetNLayers()
+    assert loaded.GetSlabHeight() == tentslab.GetSlabHeight()
+    for i in range(tentslab.GetNTents()):
+        t1, t2 = tentslab.GetTent(i), loaded.GetTent(i)
+        assert (t1.vertex, t1.level, t1.ttop) == (t2.vertex, t2.level, t2.ttop)
+        assert list(t1.els) == list(t2.els)
+
+    other = Mesh(unit_square.GenerateMesh(maxh=.2))
+    with pytest.raises(Exception):
+        TentSlab(other, "edge", 5 * 1000 * 1000).Load(filename)
+
+    # the tents only fit the pitching method, dt and wavespeed they were
+    # pitched for
+    loaded = TentSlab(mesh, "edge", 5 * 1000 * 1000)
+    loaded.SetMaxWavespeed(1)
+    loaded.Load(filename, dt=0.5)
+    with pytest.raises(Exception):
+        TentSlab(mesh, "vol", 5 * 1000 * 1000).Load(filename)
+    with pytest.raises(Exception):
+        TentSlab(mesh, "edge", 5 * 1000 * 1000).Load(filename, dt=0.25)
+    faster = TentSlab(mesh, "edge", 5 * 1000 * 1000)
+    faster.SetMaxWavespeed(2)
+    with pytest.raises(Exception):
+        faster.Load(filename)
+
+    # damaged numbers are rejected instead of being used as indices
+    with open(filename, "rb") as f:
+        data = bytearray(f.read())
+    data[-16:] = b"\xff" * 16
+    with open(filename, "wb") as f:
+        f.write(data)
+    with pytest.raises(Exception):
+        TentSlab(mesh, "edge", 5 * 1000 * 1000).Load(filename)